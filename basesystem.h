@@ -52,6 +52,20 @@ public:
 	virtual Cell_State get_cell_state(std::size_t x, std::size_t y) const = 0;
 	// return next cell state at given position; if the algorithm does not calculate next state, keep this implementation
 	inline virtual Cell_State get_next_cell_state(std::size_t x, std::size_t y) const { return get_cell_state(x, y); }
+	// copy current states (and next states if next is not nullptr) of the rectangle with upper left corner x,y into given buffers; row r starts at index r * width
+	// the rectangle must be inside the field; algorithms override this to copy the cells without a virtual call per cell
+	virtual void get_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, Cell_State* current, Cell_State* next = nullptr) const
+	{
+		for(std::size_t row = 0; row < height; ++row)
+		{
+			for(std::size_t column = 0; column < width; ++column)
+			{
+				current[row * width + column] = get_cell_state(x + column, y + row);
+				if(next)
+					next[row * width + column] = get_next_cell_state(x + column, y + row);
+			}
+		}
+	}
 
 	// return width
 	inline virtual std::size_t get_size_x() const { return size_x; }
@@ -0,0 +1,197 @@
+// © Copyright (c) 2018 SqYtCO
+
+#include "biginteger.h"
+#include <algorithm>
+#include <limits>
+
+Big_Integer::Big_Integer(std::size_t value)
+{
+	while(value)
+	{
+		digits.push_back(static_cast<uint32_t>(value));
+		value = (sizeof(std::size_t) > 4) ? (value >> 16 >> 16) : 0;
+	}
+}
+
+void Big_Integer::trim()
+{
+	while(!digits.empty() && digits.back() == 0)
+		digits.pop_back();
+}
+
+bool Big_Integer::from_string(const std::string& str, Big_Integer& result)
+{
+	if(str.empty())
+		return false;
+
+	Big_Integer value;
+	for(char c : str)
+	{
+		if(c < '0' || c > '9')
+			return false;
+
+		// value = value * 10 + digit
+		uint64_t carry = static_cast<uint64_t>(c - '0');
+		for(auto& a : value.digits)
+		{
+			carry += static_cast<uint64_t>(a) * 10;
+			a = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		if(carry)
+			value.digits.push_back(static_cast<uint32_t>(carry));
+	}
+
+	result = value;
+	return true;
+}
+
+std::string Big_Integer::to_string() const
+{
+	if(digits.empty())
+		return "0";
+
+	// divide by 10^9 repeatedly; each remainder gives 9 decimal digits
+	std::vector<uint32_t> quotient(digits);
+	std::string str;
+	while(!quotient.empty())
+	{
+		uint64_t remainder = 0;
+		for(std::size_t i = quotient.size(); i-- > 0; )
+		{
+			remainder = (remainder << 32) | quotient[i];
+			quotient[i] = static_cast<uint32_t>(remainder / 1000000000);
+			remainder %= 1000000000;
+		}
+		while(!quotient.empty() && quotient.back() == 0)
+			quotient.pop_back();
+
+		for(std::size_t i = 0; i < 9 && (remainder || !quotient.empty()); ++i)
+		{
+			str.push_back(static_cast<char>('0' + remainder % 10));
+			remainder /= 10;
+		}
+	}
+
+	std::reverse(str.begin(), str.end());
+	return str;
+}
+
+Big_Integer& Big_Integer::operator+=(const Big_Integer& other)
+{
+	if(digits.size() < other.digits.size())
+		digits.resize(other.digits.size(), 0);
+
+	uint64_t carry = 0;
+	for(std::size_t i = 0; i < digits.size(); ++i)
+	{
+		carry += static_cast<uint64_t>(digits[i]) + ((i < other.digits.size()) ? other.digits[i] : 0);
+		digits[i] = static_cast<uint32_t>(carry);
+		carry >>= 32;
+		if(carry == 0 && i >= other.digits.size())
+			break;
+	}
+	if(carry)
+		digits.push_back(static_cast<uint32_t>(carry));
+
+	return *this;
+}
+
+Big_Integer& Big_Integer::operator-=(const Big_Integer& other)
+{
+	int64_t borrow = 0;
+	for(std::size_t i = 0; i < digits.size(); ++i)
+	{
+		borrow += static_cast<int64_t>(digits[i]) - ((i < other.digits.size()) ? other.digits[i] : 0);
+		digits[i] = static_cast<uint32_t>(borrow);
+		borrow = (borrow < 0) ? -1 : 0;
+		if(borrow == 0 && i >= other.digits.size())
+			break;
+	}
+
+	trim();
+	return *this;
+}
+
+Big_Integer& Big_Integer::operator<<=(std::size_t shift)
+{
+	if(digits.empty())
+		return *this;
+
+	const std::size_t bits = shift & 31;
+	if(bits)
+	{
+		uint32_t carry = 0;
+		for(auto& a : digits)
+		{
+			uint32_t next = a >> (32 - bits);
+			a = (a << bits) | carry;
+			carry = next;
+		}
+		if(carry)
+			digits.push_back(carry);
+	}
+	digits.insert(digits.begin(), shift >> 5, 0);
+
+	return *this;
+}
+
+Big_Integer& Big_Integer::operator>>=(std::size_t shift)
+{
+	if((shift >> 5) >= digits.size())
+	{
+		digits.clear();
+		return *this;
+	}
+
+	digits.erase(digits.begin(), digits.begin() + static_cast<std::ptrdiff_t>(shift >> 5));
+	const std::size_t bits = shift & 31;
+	if(bits)
+	{
+		for(std::size_t i = 0; i < digits.size(); ++i)
+		{
+			digits[i] >>= bits;
+			if(i + 1 < digits.size())
+				digits[i] |= digits[i + 1] << (32 - bits);
+		}
+	}
+
+	trim();
+	return *this;
+}
+
+int Big_Integer::compare(const Big_Integer& other) const
+{
+	if(digits.size() != other.digits.size())
+		return (digits.size() < other.digits.size()) ? -1 : 1;
+
+	for(std::size_t i = digits.size(); i-- > 0; )
+	{
+		if(digits[i] != other.digits[i])
+			return (digits[i] < other.digits[i]) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+std::size_t Big_Integer::bit_length() const
+{
+	if(digits.empty())
+		return 0;
+
+	std::size_t length = (digits.size() - 1) * 32;
+	for(uint32_t top = digits.back(); top; top >>= 1)
+		++length;
+	return length;
+}
+
+std::size_t Big_Integer::to_size_t() const
+{
+	if(!fits_size_t())
+		return std::numeric_limits<std::size_t>::max();
+
+	std::size_t value = 0;
+	for(std::size_t i = digits.size(); i-- > 0; )
+		value = (value << 16 << 16) | digits[i];
+	return value;
+}
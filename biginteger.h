@@ -0,0 +1,62 @@
+// © Copyright (c) 2018 SqYtCO
+
+#ifndef BIGINTEGER_H
+#define BIGINTEGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* unsigned integer of arbitrary precision
+ * it is used for generations, populations and coordinates of HashLife at the interface only (e.g. generation counter, step size); the calculation itself uses native words
+ * the value is stored as 32-bit digits with the least significant digit first; there are no leading zero digits, so zero has no digits */
+class Big_Integer
+{
+	std::vector<uint32_t> digits;
+
+	// remove leading zero digits
+	void trim();
+
+public:
+	Big_Integer(std::size_t value = 0);
+
+	// parse decimal number; return false if given string contains anything else than digits
+	static bool from_string(const std::string& str, Big_Integer& result);
+	// return decimal representation
+	std::string to_string() const;
+
+	Big_Integer& operator+=(const Big_Integer& other);
+	// other must not be greater than this value
+	Big_Integer& operator-=(const Big_Integer& other);
+	Big_Integer& operator<<=(std::size_t shift);
+	Big_Integer& operator>>=(std::size_t shift);
+
+	// return -1, 0 or 1 if this value is lower than, equal to or greater than other
+	int compare(const Big_Integer& other) const;
+
+// get functions
+	inline bool is_zero() const { return digits.empty(); }
+	// return num of significant bits (0 for zero)
+	std::size_t bit_length() const;
+	// return bit with given exponent
+	inline bool get_bit(std::size_t exp) const { return (exp >> 5) < digits.size() && ((digits[exp >> 5] >> (exp & 31)) & 0x01); }
+	// return true if value fits into std::size_t
+	inline bool fits_size_t() const { return bit_length() <= sizeof(std::size_t) * 8; }
+	// return value as std::size_t; it is saturated at the largest std::size_t
+	std::size_t to_size_t() const;
+};
+
+inline Big_Integer operator+(Big_Integer a, const Big_Integer& b) { return a += b; }
+inline Big_Integer operator-(Big_Integer a, const Big_Integer& b) { return a -= b; }
+inline Big_Integer operator<<(Big_Integer a, std::size_t shift) { return a <<= shift; }
+inline Big_Integer operator>>(Big_Integer a, std::size_t shift) { return a >>= shift; }
+
+inline bool operator==(const Big_Integer& a, const Big_Integer& b) { return a.compare(b) == 0; }
+inline bool operator!=(const Big_Integer& a, const Big_Integer& b) { return a.compare(b) != 0; }
+inline bool operator<(const Big_Integer& a, const Big_Integer& b) { return a.compare(b) < 0; }
+inline bool operator<=(const Big_Integer& a, const Big_Integer& b) { return a.compare(b) <= 0; }
+inline bool operator>(const Big_Integer& a, const Big_Integer& b) { return a.compare(b) > 0; }
+inline bool operator>=(const Big_Integer& a, const Big_Integer& b) { return a.compare(b) >= 0; }
+
+#endif // BIGINTEGER_H
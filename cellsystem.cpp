@@ -1,37 +1,161 @@
 // © Copyright (c) 2018 SqYtCO
 
 #include "cellsystem.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <random>
 
+// header of the checkpoint file; it is followed by the current and the next state (each size_x * size_y + 1 cells)
+struct Checkpoint_Header
+{
+	char magic[8];
+	std::uint64_t size_x;
+	std::uint64_t size_y;
+	std::uint64_t border_behavior;
+	std::uint64_t survival_rules;
+	std::uint64_t rebirth_rules;
+	std::uint64_t current_system;
+	std::uint64_t generation;
+};
+
+static constexpr char checkpoint_magic[8] = { 'G', 'O', 'L', 'G', 'R', 'I', 'D', '1' };
+// the header occupies one page, so the states are page aligned for the madvise() hints
+static constexpr std::size_t checkpoint_header_size = 4096;
+
 Cell_System::Cell_System(std::size_t columns, std::size_t rows, const Border_Behavior& border_behavior,
-			std::size_t survival_rules, std::size_t rebirth_rules, std::size_t threads) : Base_System(columns, rows), current_system(0),
-																											survival_rules(survival_rules), rebirth_rules(rebirth_rules),
-																											border_behavior(border_behavior)
+			std::size_t survival_rules, std::size_t rebirth_rules, std::size_t threads, const std::string& mapping_file)
+																						: Base_System(columns, rows), checkpoint_generation(0), valid(true), current_system(0),
+																							survival_rules(survival_rules), rebirth_rules(rebirth_rules), num_of_threads(1),
+																							border_behavior(border_behavior)
 {
 	// check given num and set num_of_threads
 	set_num_of_threads(threads);
 
-	if(border_behavior == Border_Behavior::Continue_On_Opposite_Side)	// "opposite"-behavior
+	// create cells for current and next state
+	init_storage(mapping_file);
+
+	// set all cells to dead
+	set_all(Dead);
+}
+
+Cell_System::Cell_System(const std::string& checkpoint_file, std::size_t threads) : Base_System(0, 0), checkpoint_generation(0), valid(false), current_system(0),
+																					survival_rules(0), rebirth_rules(0), num_of_threads(1),
+																					border_behavior(Border_Behavior::Surrounded_By_Dead_Cells)
+{
+	system[0] = system[1] = nullptr;
+
+	if(!mapping.open(checkpoint_file) || mapping.get_size() < checkpoint_header_size)
+		return;
+
+	Checkpoint_Header header;
+	std::memcpy(&header, mapping.data(), sizeof(header));
+
+	// the size of the states must not overflow, so a damaged header can not match a small file
+	const std::uint64_t max_cells = (SIZE_MAX - checkpoint_header_size) / 2 / sizeof(Cell_State) - 1;
+	if(header.size_x == 0 || header.size_y == 0 || header.size_x > max_cells / header.size_y)
 	{
-		// create cells for current state
-		system[current_system].resize(columns * rows);
-		// create cells for next state
-		system[current_system ^ 0x01].resize(columns * rows);
+		mapping.close();
+		return;
 	}
-	else	// "special border"-behavior
+
+	// check file type, size and border behavior; Cell_System does not implement Borderless
+	if(std::memcmp(header.magic, checkpoint_magic, sizeof(checkpoint_magic)) != 0 ||
+			mapping.get_size() != checkpoint_header_size + 2 * (header.size_x * header.size_y + 1) * sizeof(Cell_State) ||
+			(header.border_behavior != Border_Behavior::Continue_On_Opposite_Side && header.border_behavior != Border_Behavior::Surrounded_By_Dead_Cells &&
+			 header.border_behavior != Border_Behavior::Surrounded_By_Living_Cells))
 	{
-		// create cells for current state; last cell reserved for border behavior "Surrounded_By_Dead_Cells/Surrounded_By_Living_Cells"
-		system[current_system].resize(columns * rows + 1);
-		// create cells for next state; last cell reserved for border behavior "Surrounded_By_Dead_Cells/Surrounded_By_Living_Cells"
-		system[current_system ^ 0x01].resize(columns * rows + 1);
-
-		// set last cell for special border behavior to alive or dead
-		system[current_system][columns * rows] = static_cast<Cell_State>(border_behavior == Border_Behavior::Surrounded_By_Living_Cells);
-		system[current_system ^ 0x01][columns * rows] = static_cast<Cell_State>(border_behavior == Border_Behavior::Surrounded_By_Living_Cells);
+		mapping.close();
+		return;
 	}
 
-	// set all cells to dead
-	set_all(Dead);
+	size_x = header.size_x;
+	size_y = header.size_y;
+	border_behavior = static_cast<Border_Behavior>(header.border_behavior);
+	// rules of 0 - 8 neighbors
+	survival_rules = header.survival_rules & 0x1FF;
+	rebirth_rules = header.rebirth_rules & 0x1FF;
+	current_system = header.current_system & 0x01;
+	checkpoint_generation = header.generation;
+	mapping_file = checkpoint_file;
+
+	// the next state is stored in the checkpoint, so no calculation is required
+	system[0] = reinterpret_cast<Cell_State*>(mapping.data() + get_mapping_offset(0, 0));
+	system[1] = reinterpret_cast<Cell_State*>(mapping.data() + get_mapping_offset(1, 0));
+	mapping.advise_sequential();
+
+	set_num_of_threads(threads);
+	valid = true;
+}
+
+void Cell_System::init_storage(const std::string& file)
+{
+	// last cell reserved for border behavior "Surrounded_By_Dead_Cells/Surrounded_By_Living_Cells"
+	std::size_t cells = size_x * size_y + 1;
+
+	if(!file.empty() && mapping.create(file, checkpoint_header_size + 2 * cells * sizeof(Cell_State)))
+	{
+		mapping_file = file;
+		system[0] = reinterpret_cast<Cell_State*>(mapping.data() + get_mapping_offset(0, 0));
+		system[1] = reinterpret_cast<Cell_State*>(mapping.data() + get_mapping_offset(1, 0));
+		mapping.advise_sequential();
+	}
+	else
+	{
+		storage[0].resize(cells);
+		storage[1].resize(cells);
+		system[0] = storage[0].data();
+		system[1] = storage[1].data();
+	}
+
+	// set last cell for special border behavior to alive or dead
+	system[current_system][size_x * size_y] = static_cast<Cell_State>(border_behavior == Border_Behavior::Surrounded_By_Living_Cells);
+	system[current_system ^ 0x01][size_x * size_y] = static_cast<Cell_State>(border_behavior == Border_Behavior::Surrounded_By_Living_Cells);
+
+	// mapped file is a valid checkpoint from the beginning
+	if(mapping.is_mapped())
+		write_checkpoint(mapping_file, 0);
+}
+
+std::size_t Cell_System::get_mapping_offset(std::size_t state, std::size_t pos) const
+{
+	return checkpoint_header_size + (state * (size_x * size_y + 1) + pos) * sizeof(Cell_State);
+}
+
+bool Cell_System::write_checkpoint(const std::string& file, std::size_t generation)
+{
+	Checkpoint_Header header;
+	std::memcpy(header.magic, checkpoint_magic, sizeof(checkpoint_magic));
+	header.size_x = size_x;
+	header.size_y = size_y;
+	header.border_behavior = static_cast<std::uint64_t>(border_behavior);
+	header.survival_rules = survival_rules;
+	header.rebirth_rules = rebirth_rules;
+	header.current_system = current_system;
+	header.generation = generation;
+
+	// the mapped file is already up to date; write only header and sync
+	if(mapping.is_mapped() && file == mapping_file)
+	{
+		checkpoint_generation = generation;
+		std::memcpy(mapping.data(), &header, sizeof(header));
+		return mapping.sync();
+	}
+
+	std::ofstream out(file, std::ios::binary);
+	// if creating fails
+	if(!out)
+		return false;
+
+	// write header padded to checkpoint_header_size and both states
+	std::vector<char> header_page(checkpoint_header_size, 0);
+	std::memcpy(header_page.data(), &header, sizeof(header));
+	out.write(header_page.data(), static_cast<std::streamsize>(header_page.size()));
+	for(std::size_t state = 0; state < 2; ++state)
+		out.write(system[state], static_cast<std::streamsize>((size_x * size_y + 1) * sizeof(Cell_State)));
+
+	return static_cast<bool>(out);
 }
 
 void Cell_System::set_num_of_threads(std::size_t threads)
@@ -112,29 +236,36 @@ void Cell_System::calc_cell_special_border_behavior(std::size_t x, std::size_t y
 
 void Cell_System::calc_part(std::size_t max_x, std::size_t min_x, std::size_t max_y, std::size_t min_y)
 {
-	std::size_t x = max_x, y = max_y;
-
-	// if statement outside of loop to improve performance
-	if(border_behavior == Continue_On_Opposite_Side)
+	// calculate rows in bands from top to bottom to access a mapped file sequentially
+	for(std::size_t band_begin = min_y; band_begin < max_y; band_begin += band_rows)
 	{
-		while(y-- > min_y)
-		{
-			while(x-- > min_x)
-				calc_cell_opposite_behavior(x, y);
+		std::size_t band_end = std::min(band_begin + band_rows, max_y);
 
-			// reset x
-			x = max_x;
+		// read ahead next band of current state
+		if(mapping.is_mapped() && band_end < max_y)
+			mapping.advise_will_need(get_mapping_offset(current_system, band_end * size_x), band_rows * size_x * sizeof(Cell_State));
+
+		// if statement outside of loop to improve performance
+		if(border_behavior == Continue_On_Opposite_Side)
+		{
+			for(std::size_t y = band_begin; y < band_end; ++y)
+				for(std::size_t x = min_x; x < max_x; ++x)
+					calc_cell_opposite_behavior(x, y);
 		}
-	}
-	else
-	{
-		while(y-- > min_y)
+		else
 		{
-			while(x-- > min_x)
-				calc_cell_special_border_behavior(x, y);
+			for(std::size_t y = band_begin; y < band_end; ++y)
+				for(std::size_t x = min_x; x < max_x; ++x)
+					calc_cell_special_border_behavior(x, y);
+		}
 
-			// reset x
-			x = max_x;
+		if(mapping.is_mapped())
+		{
+			// release calculated band of next state; dirty pages are written back by the kernel
+			mapping.advise_dont_need(get_mapping_offset(current_system ^ 0x01, band_begin * size_x), (band_end - band_begin) * size_x * sizeof(Cell_State));
+			// release rows of current state which are not required as neighbors of the next band
+			if(band_end - band_begin > 1)
+				mapping.advise_dont_need(get_mapping_offset(current_system, band_begin * size_x), (band_end - band_begin - 1) * size_x * sizeof(Cell_State));
 		}
 	}
 }
@@ -143,19 +274,14 @@ void Cell_System::calc_next_generation()
 {
 	// calc rows per thread
 	std::size_t y_per_job = size_y / num_of_threads;
-	// calc does not work out evenly
+	// calc does not work out evenly; the remaining rows are calculated by the calling thread
 	std::size_t odd_ys = size_y % num_of_threads;
 
-	if(num_of_threads == 1)
-		odd_ys = size_y;
-	else
-	{
-		// start set amount of threads with given y_per_job
-		for(std::size_t i = 0; i < threads.size(); ++i)
-			threads[i] = std::thread(&Cell_System::calc_part, this, size_x, 0, y_per_job * (i + 1) + odd_ys, y_per_job * i + odd_ys);
-	}
+	// start set amount of threads with given y_per_job; the calling thread calculates the first job
+	for(std::size_t i = 0; i < threads.size(); ++i)
+		threads[i] = std::thread(&Cell_System::calc_part, this, size_x, 0, y_per_job * (i + 2) + odd_ys, y_per_job * (i + 1) + odd_ys);
 
-	calc_part(size_x, 0, odd_ys, 0);
+	calc_part(size_x, 0, y_per_job + odd_ys, 0);
 
 	for(std::size_t i = 0; i < threads.size(); ++i)
 		threads[i].join();
@@ -166,6 +292,14 @@ void Cell_System::next_generation()
 	// update state to next_state: change system to next generation (precalculated)
 	current_system ^= 0x01;
 
+	// keep header of mapped file consistent with the current state
+	if(mapping.is_mapped())
+	{
+		Checkpoint_Header* header = reinterpret_cast<Checkpoint_Header*>(mapping.data());
+		header->current_system = current_system;
+		header->generation = ++checkpoint_generation;
+	}
+
 	// calculate new next_state
 	calc_next_generation();
 }
@@ -191,6 +325,16 @@ void Cell_System::set_cell(std::size_t x, std::size_t y, Cell_State state)
 	system[current_system ^ 0x01][y * size_x + x] = state;
 }
 
+void Cell_System::get_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, Cell_State* current, Cell_State* next) const
+{
+	for(std::size_t row = 0; row < height; ++row)
+	{
+		std::copy_n(system[current_system] + (y + row) * size_x + x, width, current + row * width);
+		if(next)
+			std::copy_n(system[current_system ^ 0x01] + (y + row) * size_x + x, width, next + row * width);
+	}
+}
+
 void Cell_System::set_all(Cell_State state)
 {
 	for(std::size_t row = 0; row < size_y; ++row)
@@ -5,17 +5,26 @@
 
 #include "basesystem.h"
 #include "configuration.h"
+#include "mappedbuffer.h"
 #include <cstddef>
+#include <string>
 #include <vector>
 #include <array>
 #include <thread>
 
 /* implementation of algorithm
  * in the algorithm two 1D container (std::vector for variable size) are used to store the cells with current and next state
- * each update is a toggle of the index (current_system) and the calculation of the next generation */
+ * each update is a toggle of the index (current_system) and the calculation of the next generation
+ * alternatively both states can be stored in a memory-mapped file (out-of-core); then the cells are calculated in bands of rows which are streamed sequentially
+ * the mapped file has the checkpoint layout (header + both states), so it can be mapped again by the checkpoint ctor without reading the cells */
 class Cell_System : public Base_System
 {
-	std::vector<Cell_State> system[2];				// containers for cells
+	Cell_State* system[2];							// cells of both states; point into storage or mapping
+	std::vector<Cell_State> storage[2];				// containers for cells if no file is mapped
+	Mapped_Buffer mapping;							// mapped checkpoint file; contains header and both states
+	std::string mapping_file;						// path of mapped file
+	std::size_t checkpoint_generation;				// generation stored in the header of the mapped checkpoint
+	bool valid;										// false if given checkpoint could not be mapped
 
 	std::size_t current_system;					// index for currently active container
 
@@ -65,6 +74,14 @@ class Cell_System : public Base_System
 		return static_cast<std::size_t>(y) * size_x + static_cast<std::size_t>(x);
 	}
 
+	// number of rows which are calculated together before the kernel is advised to stream the next band of a mapped file
+	static constexpr std::size_t band_rows = 64;
+
+	// allocate storage or create mapping with given file; set system pointers and initial border cells
+	void init_storage(const std::string& file);
+	// return offset of given cell of given state in the mapped file
+	std::size_t get_mapping_offset(std::size_t state, std::size_t pos) const;
+
 	// calculate next states of all cells between max_x/max_y and min_x/min_y; used for calculation with multiple threads
 	void calc_part(std::size_t max_x, std::size_t min_x, std::size_t max_y, std::size_t min_y);
 	// calculate next state of one cell with "Continue_On_Opposite_Side" behavior; function pointers are too expensive because they can not be inlined
@@ -74,10 +91,23 @@ class Cell_System : public Base_System
 
 public:
 	// init instance with given width, height, border behavior, rule sets and number of used threads; the given rule sets have to represent their rules with a bitmask
+	// if mapping_file is not empty, the cells are stored in this file (it is created or truncated); if mapping fails, the cells are stored in memory
 	Cell_System(std::size_t columns, std::size_t rows, const Border_Behavior& border_behavior,
-				std::size_t survival_rules = (1 << 2) | (1 << 3), std::size_t rebirth_rules = (1 << 3), std::size_t threads = 1);
+				std::size_t survival_rules = (1 << 2) | (1 << 3), std::size_t rebirth_rules = (1 << 3), std::size_t threads = 1,
+				const std::string& mapping_file = std::string());
+	// map given checkpoint file (written by write_checkpoint()); size, rules, border behavior and states are read from the file; check is_valid() afterwards
+	Cell_System(const std::string& checkpoint_file, std::size_t threads = 1);
 	virtual ~Cell_System() override = default;
 
+	// write checkpoint (header and both states) to given file; if the file is the mapped file, only the header is updated and the mapping is synced
+	bool write_checkpoint(const std::string& file, std::size_t generation);
+	// return generation stored in the mapped checkpoint
+	inline std::size_t get_checkpoint_generation() const { return checkpoint_generation; }
+	// return true if the checkpoint ctor mapped the given file successfully; always true for the other ctor
+	inline bool is_valid() const { return valid; }
+	// return true if the cells are stored in a mapped file
+	inline bool is_mapped() const { return mapping.is_mapped(); }
+
 	virtual void random_cells(std::size_t alive, std::size_t dead) override;
 
 	// calculate next state of every cell;
@@ -107,6 +137,8 @@ public:
 	{
 		return system[current_system ^ 0x01][y * size_x + x];
 	}
+	// copy rows of given rectangle
+	virtual void get_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, Cell_State* current, Cell_State* next = nullptr) const override;
 };
 
 #endif // CELLSYSTEM_H
@@ -27,12 +27,20 @@ void Configuration::reset_config()
 	size_x = Default_Values::SIZE_X;
 	size_y = Default_Values::SIZE_Y;
 	num_of_threads = Default_Values::NUM_OF_THREADS;
+	num_of_processes = Default_Values::NUM_OF_PROCESSES;
 	relation_dead = Default_Values::RELATION_DEAD;
 	relation_alive = Default_Values::RELATION_ALIVE;
 	border_behavior = Default_Values::BORDER_BEHAVIOR;
 	start_random = Default_Values::START_RANDOM;
 	survival_rules = Default_Values::SURVIVAL_RULES;
 	rebirth_rules = Default_Values::REBORN_RULES;
+	mapping_file = Default_Values::MAPPING_FILE;
+	history_size = Default_Values::HISTORY_SIZE;
+	keyframe_interval = Default_Values::KEYFRAME_INTERVAL;
+	hashlife_memory = Default_Values::HASHLIFE_MEMORY;
+	hashlife_store = Default_Values::HASHLIFE_STORE;
+	hashlife_store_size = Default_Values::HASHLIFE_STORE_SIZE;
+	hashlife_symmetry = Default_Values::HASHLIFE_SYMMETRY;
 }
 
 bool Configuration::read_config()
@@ -59,6 +67,8 @@ bool Configuration::read_config()
 			size_y = std::stoul(value);
 		else if(property == "num_of_threads")
 			num_of_threads = std::stoul(value);
+		else if(property == "num_of_processes")
+			num_of_processes = std::stoul(value);
 		else if(property == "relation_dead")
 			relation_dead = std::stoul(value);
 		else if(property == "relation_alive")
@@ -71,6 +81,20 @@ bool Configuration::read_config()
 			survival_rules = std::stoul(value);
 		else if(property == "rebirth_rules")
 			rebirth_rules = std::stoul(value);
+		else if(property == "mapping_file")
+			mapping_file = value;
+		else if(property == "history_size")
+			history_size = std::stoul(value);
+		else if(property == "keyframe_interval")
+			keyframe_interval = std::stoul(value);
+		else if(property == "hashlife_memory")
+			hashlife_memory = std::stoul(value);
+		else if(property == "hashlife_store")
+			hashlife_store = value;
+		else if(property == "hashlife_store_size")
+			hashlife_store_size = std::stoul(value);
+		else if(property == "hashlife_symmetry")
+			hashlife_symmetry = std::stoul(value);
 	}
 
 	config_saved = true;
@@ -101,12 +125,20 @@ bool Configuration::write_config()
 	out << "size_x=" << size_x << '\n'
 		<< "size_y=" << size_y << '\n'
 		<< "num_of_threads=" << num_of_threads << '\n'
+		<< "num_of_processes=" << num_of_processes << '\n'
 		<< "relation_dead=" << relation_dead << '\n'
 		<< "relation_alive=" << relation_alive << '\n'
 		<< "border_behavior=" << static_cast<int>(border_behavior) << '\n'
 		<< "start_random=" << start_random << '\n'
 		<< "survival_rules=" << survival_rules << '\n'
-		<< "rebirth_rules=" << rebirth_rules;
+		<< "rebirth_rules=" << rebirth_rules << '\n'
+		<< "mapping_file=" << mapping_file << '\n'
+		<< "history_size=" << history_size << '\n'
+		<< "keyframe_interval=" << keyframe_interval << '\n'
+		<< "hashlife_memory=" << hashlife_memory << '\n'
+		<< "hashlife_store=" << hashlife_store << '\n'
+		<< "hashlife_store_size=" << hashlife_store_size << '\n'
+		<< "hashlife_symmetry=" << hashlife_symmetry;
 
 	// return on error
 	if(!out)
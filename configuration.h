@@ -22,6 +22,7 @@ namespace Default_Values
 	constexpr std::size_t SIZE_X = 100;
 	constexpr std::size_t SIZE_Y = 100;
 	constexpr std::size_t NUM_OF_THREADS = 4;
+	constexpr std::size_t NUM_OF_PROCESSES = 1;
 	constexpr std::size_t RELATION_DEAD = 2;
 	constexpr std::size_t RELATION_ALIVE = 1;
 	constexpr Border_Behavior BORDER_BEHAVIOR = Borderless;
@@ -29,6 +30,13 @@ namespace Default_Values
 	constexpr bool START_RANDOM = true;
 	constexpr std::size_t SURVIVAL_RULES = 0x0C;	// 2 & 3
 	constexpr std::size_t REBORN_RULES = 0x08;		// 3
+	constexpr const char* MAPPING_FILE = "";
+	constexpr std::size_t HISTORY_SIZE = 64;		// MiB
+	constexpr std::size_t KEYFRAME_INTERVAL = 32;
+	constexpr std::size_t HASHLIFE_MEMORY = 1024;	// MiB
+	constexpr const char* HASHLIFE_STORE = "";
+	constexpr std::size_t HASHLIFE_STORE_SIZE = 256;	// MiB
+	constexpr bool HASHLIFE_SYMMETRY = false;
 }
 
 // contain and manage all non-graphic preferences
@@ -62,36 +70,60 @@ private:
 	std::size_t size_x;						// width (num of columns) of new created games
 	std::size_t size_y;						// height (num of rows) of new created games
 	std::size_t num_of_threads;				// number of used threads for calculation; the max. performance is reached when num_of_threads is equal to the number of cores
+	std::size_t num_of_processes;			// number of processes which calculate stripes of a bounded game board; 1 disables the multi-process mode
 	std::size_t relation_dead;				// determines ratio between living and dead cells by creating random cells; relation_dead is the proportion of dead cells
 	std::size_t relation_alive;				// determines ratio between living and dead cells by creating random cells; relation_alive is the proportion of living cells
 	Border_Behavior border_behavior;		// set behavior on borders (neighbors of border cells)
 	bool start_random;						// if true, on startup only dead cells are generated
 	std::size_t survival_rules;					// ruleset to survive: numbers are represented by a bitmask: (1<<X); X=neighbors
 	std::size_t rebirth_rules;				// ruleset to be born: numbers are represented by a bitmask: (1<<X); X=neighbors
+	std::string mapping_file;				// if not empty, the cells of bounded games are stored in this memory-mapped file (allows games larger than the physical memory)
+	std::size_t history_size;				// max. memory usage of previous generations in MiB; 0 disables the history
+	std::size_t keyframe_interval;			// num of generations in history between complete states
+	std::size_t hashlife_memory;			// max. memory usage of macrocells in MiB; unreachable macrocells are collected if it is exceeded
+	std::string hashlife_store;				// if not empty, results of large macrocells are kept in this file for later sessions
+	std::size_t hashlife_store_size;		// max. size of hashlife_store in MiB; the least recently used results are dropped if it is exceeded
+	bool hashlife_symmetry;					// if true, HashLife reuses results of mirrored and rotated macrocells (faster for symmetric patterns, slower for others)
 
 // set options
 public:
 	inline void set_size_x(std::size_t new_size_x) { config_saved = false; size_x = new_size_x; }
 	inline void set_size_y(std::size_t new_size_y) { config_saved = false; size_y = new_size_y; }
 	inline void set_num_of_threads(std::size_t new_num_of_threads) { config_saved = false; num_of_threads = new_num_of_threads; }
+	inline void set_num_of_processes(std::size_t new_num_of_processes) { config_saved = false; num_of_processes = new_num_of_processes; }
 	inline void set_relation_dead(const std::size_t new_relation_dead) { config_saved = false; relation_dead = new_relation_dead; }
 	inline void set_relation_alive(const std::size_t new_relation_alive) { config_saved = false; relation_alive = new_relation_alive; }
 	inline void set_border_behavior(const Border_Behavior& new_border_behavior) { config_saved = false; border_behavior = new_border_behavior; }
 	inline void set_start_random(const bool& new_start_random) { config_saved = false; start_random = new_start_random; }
 	inline void set_survival_rules(std::size_t new_survival_rules) { config_saved = false; survival_rules = new_survival_rules; }
 	inline void set_rebirth_rules(std::size_t new_rebirth_rules) { config_saved = false; rebirth_rules = new_rebirth_rules; }
+	inline void set_mapping_file(const std::string& new_mapping_file) { config_saved = false; mapping_file = new_mapping_file; }
+	inline void set_history_size(std::size_t new_history_size) { config_saved = false; history_size = new_history_size; }
+	inline void set_keyframe_interval(std::size_t new_keyframe_interval) { config_saved = false; keyframe_interval = new_keyframe_interval; }
+	inline void set_hashlife_memory(std::size_t new_hashlife_memory) { config_saved = false; hashlife_memory = new_hashlife_memory; }
+	inline void set_hashlife_store(const std::string& new_hashlife_store) { config_saved = false; hashlife_store = new_hashlife_store; }
+	inline void set_hashlife_store_size(std::size_t new_hashlife_store_size) { config_saved = false; hashlife_store_size = new_hashlife_store_size; }
+	inline void set_hashlife_symmetry(bool new_hashlife_symmetry) { config_saved = false; hashlife_symmetry = new_hashlife_symmetry; }
 
 // get options
 public:
 	inline std::size_t get_size_x() const { return size_x; }
 	inline std::size_t get_size_y() const { return size_y; }
 	inline std::size_t get_num_of_threads() const { return num_of_threads; }
+	inline std::size_t get_num_of_processes() const { return num_of_processes; }
 	inline std::size_t get_relation_dead() const { return relation_dead; }
 	inline std::size_t get_relation_alive() const { return relation_alive; }
 	inline const Border_Behavior& get_border_behavior() const { return border_behavior; }
 	inline const bool& get_start_random() const { return start_random; }
 	inline std::size_t get_survival_rules() { return survival_rules; }
 	inline std::size_t get_rebirth_rules() { return rebirth_rules; }
+	inline const std::string& get_mapping_file() const { return mapping_file; }
+	inline std::size_t get_history_size() const { return history_size; }
+	inline std::size_t get_keyframe_interval() const { return keyframe_interval; }
+	inline std::size_t get_hashlife_memory() const { return hashlife_memory; }
+	inline const std::string& get_hashlife_store() const { return hashlife_store; }
+	inline std::size_t get_hashlife_store_size() const { return hashlife_store_size; }
+	inline bool get_hashlife_symmetry() const { return hashlife_symmetry; }
 };
 
 #endif // CONFIGURATION_H
@@ -3,7 +3,9 @@
 #include "core.h"
 #include "cellsystem.h"
 #include "hashlifesystem.h"
+#include "stripesystem.h"
 #include <fstream>
+#include <vector>
 
 #if __cplusplus < 201703L
 #include <experimental/filesystem>
@@ -18,45 +20,262 @@ namespace std
 
 Configuration Core::config;
 std::unique_ptr<Base_System> Core::system_;
-std::size_t Core::generation;
+Big_Integer Core::generation;
+Generation_History Core::history;
 
-std::size_t Core::next_generation(std::size_t generations)
+void Core::reset_history()
 {
+	history.clear();
+
+	// the history keeps a copy of the whole state in memory, which does not fit for mapped games
+	Cell_System* cells = dynamic_cast<Cell_System*>(system_.get());
+	if(cells && cells->is_mapped())
+		history.set_limits(0, config.get_keyframe_interval());
+	else
+		history.set_limits(config.get_history_size() << 20, config.get_keyframe_interval());
+}
+
+Big_Integer Core::next_generation(const Big_Integer& generations, bool lookahead)
+{
+	Big_Integer advanced;
+	// store current state before updating; without lookahead (while generating) dense states are recorded less often
+	history.record(generation, system_.get(), !lookahead);
+
 	HashLife_System* temp = dynamic_cast<HashLife_System*>(system_.get());
+	Stripe_System* stripes = dynamic_cast<Stripe_System*>(system_.get());
 	if(temp)
 	{
-		generation += temp->next_generation(generations);
-		return generations;
+		advanced = temp->next_generation(generations, lookahead);
+		collect_garbage(temp);
+	}
+	else if(stripes)
+	{
+		// one command advances all stripes by all generations; halos are exchanged with a barrier in each generation
+		advanced = stripes->next_generation(generations.to_size_t());
+		replace_failed_stripes();
+	}
+	else
+	{
+		system_->next_generation();
+		advanced = 1;
 	}
 
-	system_->next_generation();
-	++generation;
-	return 1;
+	generation += advanced;
+	history.advanced(generation);
+	return advanced;
+}
+
+Big_Integer Core::next_hyperspeed_step(std::size_t budget, bool lookahead)
+{
+	HashLife_System* temp = dynamic_cast<HashLife_System*>(system_.get());
+	if(!temp)
+		return next_generation(1, lookahead);
+
+	// store current state before updating
+	history.record(generation, system_.get());
+
+	Big_Integer advanced = temp->next_hyperspeed_step(budget, lookahead);
+	collect_garbage(temp);
+
+	generation += advanced;
+	history.advanced(generation);
+	return advanced;
+}
+
+void Core::collect_garbage(HashLife_System* system)
+{
+	const std::size_t memory_limit = config.get_hashlife_memory() << 20;
+	if(!Macrocell::hash_table.needs_collection(memory_limit))
+		return;
+
+	// the history roots keep their macrocells; if they still exceed the limit, the oldest half of the history is dropped and the cells are collected again
+	do
+	{
+		std::vector<Macrocell_Ref> roots{ system->get_master_cell(), system->get_next_cell() };
+		history.get_roots(roots);
+		Macrocell::hash_table.collect_garbage(roots);
+	} while(Macrocell::hash_table.get_memory_usage() > memory_limit && history.drop_oldest_roots());
 }
 
-void Core::calc_next_generation(std::size_t generations)
+void Core::calc_next_generation(const Big_Integer& generations)
 {
 	HashLife_System* temp = dynamic_cast<HashLife_System*>(system_.get());
 	if(temp)
 		temp->calc_next_generation(generations);
 	else
+	{
 		system_->calc_next_generation();
+		replace_failed_stripes();
+	}
+}
+
+void Core::calc_next_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, const Big_Integer& generations)
+{
+	HashLife_System* temp = dynamic_cast<HashLife_System*>(system_.get());
+	if(!temp || temp->has_next_states(x, y, width, height, generations))
+		return;
+
+	// the whole next state is calculated if the rectangle covers the universe or its light cone is too large
+	if((width < temp->get_size_x() || height < temp->get_size_y()) && temp->calc_next_region(x, y, width, height, generations))
+		return;
+	temp->calc_next_generation(generations);
+}
+
+void Core::replace_failed_stripes()
+{
+	Stripe_System* stripes = dynamic_cast<Stripe_System*>(system_.get());
+	if(!stripes || stripes->is_valid())
+		return;
+
+	std::unique_ptr<Cell_System> cells(new Cell_System(stripes->get_size_x(), stripes->get_size_y(), stripes->get_border_behavior(),
+													   stripes->get_survival_rules(), stripes->get_rebirth_rules(), config.get_num_of_threads()));
+	// the stripes still contain the last state which was reached by all processes
+	std::vector<Cell_State> row(stripes->get_size_x());
+	for(std::size_t y = 0; y < stripes->get_size_y(); ++y)
+	{
+		stripes->get_cell_states(0, y, row.size(), 1, row.data());
+		for(std::size_t x = 0; x < row.size(); ++x)
+			cells->set_cell(x, y, row[x]);
+	}
+
+	// the remaining worker processes are terminated
+	system_.reset(cells.release());
+	system_->calc_next_generation();
+	history.invalidate();
+}
+
+// return true if given file name ends with given extension
+static inline bool has_extension(const std::string& file, const std::string& extension)
+{
+	return file.size() >= extension.size() && file.compare(file.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// return rule in notation B.../S... (e.g. B3/S23 for Conway's Game of Life)
+static std::string rule_to_string(std::size_t survival_rules, std::size_t rebirth_rules)
+{
+	std::string rule("B");
+	for(std::size_t n = 0; n <= 8; ++n)
+		if(rebirth_rules & (1 << n))
+			rule.push_back(static_cast<char>('0' + n));
+	rule += "/S";
+	for(std::size_t n = 0; n <= 8; ++n)
+		if(survival_rules & (1 << n))
+			rule.push_back(static_cast<char>('0' + n));
+
+	return rule;
+}
+
+// parse rule in notation B.../S... (any order and case) or S.../B... (e.g. 23/3); return false if it is invalid
+static bool rule_from_string(const std::string& rule, std::size_t& survival_rules, std::size_t& rebirth_rules)
+{
+	const std::size_t slash = rule.find('/');
+	if(slash == std::string::npos)
+		return false;
+
+	std::string parts[2] = { rule.substr(0, slash), rule.substr(slash + 1) };
+	std::size_t* targets[2] = { &survival_rules, &rebirth_rules };
+	if(!parts[0].empty() && !parts[1].empty() && (parts[0][0] == 'B' || parts[0][0] == 'b' || parts[0][0] == 'S' || parts[0][0] == 's'))
+	{
+		// each part starts with its letter
+		for(std::size_t i = 0; i < 2; ++i)
+		{
+			const char letter = parts[i][0];
+			if(letter == 'B' || letter == 'b')
+				targets[i] = &rebirth_rules;
+			else if(letter == 'S' || letter == 's')
+				targets[i] = &survival_rules;
+			else
+				return false;
+			parts[i].erase(0, 1);
+		}
+		if(targets[0] == targets[1])
+			return false;
+	}
+
+	std::size_t values[2] = { 0, 0 };
+	for(std::size_t i = 0; i < 2; ++i)
+	{
+		for(char c : parts[i])
+		{
+			if(c < '0' || c > '8')
+				return false;
+			values[i] |= 1 << (c - '0');
+		}
+	}
+
+	*targets[0] = values[0];
+	*targets[1] = values[1];
+	return true;
+}
+
+bool Core::previous_generation()
+{
+	// store current state, so it can be restored again
+	history.record(generation, system_.get());
+
+	if(!history.restore_previous(generation, system_.get(), generation))
+		return false;
+
+	system_->calc_next_generation();
+	replace_failed_stripes();
+	return true;
+}
+
+bool Core::rewind(const Big_Integer& generation)
+{
+	history.record(Core::generation, system_.get());
+
+	if(!history.restore(generation, system_.get(), Core::generation))
+		return false;
+
+	system_->calc_next_generation();
+	replace_failed_stripes();
+	return true;
 }
 
 bool Core::save(const std::string& file)
 {
+	// write checkpoint of bounded game; the file can be mapped by load()
+	if(has_extension(file, ".golm"))
+	{
+		Cell_System* cells = dynamic_cast<Cell_System*>(system_.get());
+		if(cells)
+			return cells->write_checkpoint(file, generation.to_size_t());
+		else
+			return false;
+	}
+
+	// write macrocells of HashLife game in the format of Golly; the rules are the active rules of the game
+	if(has_extension(file, ".mc"))
+	{
+		HashLife_System* hashlife = get_hashlife_system();
+		if(!hashlife)
+			return false;
+
+		std::ofstream out(file);
+		if(!out)
+			return false;
+
+		out << "[M2] (game-of-life)\n";
+		out << "#R " << rule_to_string(Macrocell::hash_table.get_survival_rules(), Macrocell::hash_table.get_rebirth_rules()) << '\n';
+		out << "#G " << generation.to_string() << '\n';
+		return hashlife->write_macrocells(out);
+	}
+
 	std::ofstream out(file);
 	// if creating fails
 	if(!out)
 		return false;
 
-	out << generation << '\n';
+	out << generation.to_string() << '\n';
 
+	std::vector<Cell_State> states(config.get_size_x());
 	for(std::size_t row = 0; row < config.get_size_y(); ++row)
 	{
+		system_->get_cell_states(0, row, states.size(), 1, states.data());
 		for(std::size_t column = 0; column < config.get_size_x(); ++column)
 		{
-			out << static_cast<int>(system_->get_cell_state(column, row)) << ' ';
+			out << static_cast<int>(states[column]) << ' ';
 		}
 
 		out << '\n';
@@ -75,8 +294,80 @@ bool Core::load(const std::string& file)
 	if(file.empty())
 		return false;
 
+	// map checkpoint; the cells are not read in
+	if(has_extension(file, ".golm"))
+	{
+		// each generation is written into the mapped file; if a mapping file is set, the checkpoint is copied to it, so the checkpoint itself is kept
+		// the copy replaces the mapping file by renaming, so a current game which maps the old file keeps its cells
+		std::string mapped_file = file;
+		const std::string& mapping_file = config.get_mapping_file();
+		std::error_code error;
+		if(!mapping_file.empty() && !std::filesystem::equivalent(file, mapping_file, error))
+		{
+			const std::string temp_file = mapping_file + ".tmp";
+			if(!std::filesystem::copy_file(file, temp_file, std::filesystem::copy_options::overwrite_existing, error))
+				return false;
+			std::filesystem::rename(temp_file, mapping_file, error);
+			if(error)
+			{
+				std::filesystem::remove(temp_file, error);
+				return false;
+			}
+			mapped_file = mapping_file;
+		}
+
+		std::unique_ptr<Cell_System> cells(new Cell_System(mapped_file, config.get_num_of_threads()));
+		if(!cells->is_valid())
+			return false;
+
+		generation = cells->get_checkpoint_generation();
+		system_.reset(cells.release());
+		reset_history();
+		return true;
+	}
+
+	// read macrocells in the format of Golly; the game is continued by HashLife with the rules of the file
+	if(has_extension(file, ".mc"))
+	{
+		std::ifstream in(file);
+		std::string line;
+		if(!in || !std::getline(in, line) || line.compare(0, 4, "[M2]") != 0)
+			return false;
+
+		// read header lines; the rules of the configuration are used if the file does not contain any
+		std::size_t survival_rules = config.get_survival_rules(), rebirth_rules = config.get_rebirth_rules();
+		Big_Integer saved_generation;
+		while(in.peek() == '#')
+		{
+			std::getline(in, line);
+			if(!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			if(line.compare(0, 3, "#R ") == 0 && !rule_from_string(line.substr(3), survival_rules, rebirth_rules))
+				return false;
+			else if(line.compare(0, 3, "#G ") == 0 && !Big_Integer::from_string(line.substr(3), saved_generation))
+				return false;
+		}
+
+		// the whole file is checked before the current game is replaced
+		std::vector<HashLife_System::Macrocell_Line> lines;
+		if(!HashLife_System::parse_macrocells(in, lines))
+			return false;
+
+		// release previous system first; the rules of the hash table are replaced by the new system
+		system_.reset();
+		HashLife_System* hashlife = new_hashlife_system(survival_rules, rebirth_rules);
+		system_.reset(hashlife);
+		hashlife->set_macrocells(lines);
+
+		generation = saved_generation;
+		reset_history();
+		system_->calc_next_generation();
+		return true;
+	}
+
 	// check if ending is equal to ".gol"; if not, return false
-	if(file.substr(file.size() - 4, 4) != ".gol")
+	if(!has_extension(file, ".gol"))
 		return false;
 
 	std::ifstream in(file);
@@ -84,7 +375,12 @@ bool Core::load(const std::string& file)
 	if(!in)
 		return false;
 
-	// skip saved generation num
+	// read in saved generation; it may exceed std::size_t
+	std::string generation_s;
+	Big_Integer saved_generation;
+	in >> generation_s;
+	if(!Big_Integer::from_string(generation_s, saved_generation))
+		return false;
 	in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
 	// count size; size_x is determined by the longest row
@@ -125,9 +421,8 @@ bool Core::load(const std::string& file)
 	// create new Cell_System
 	system_.reset(new Cell_System(size_x_max, size_y, config.get_border_behavior(), config.get_survival_rules(), config.get_rebirth_rules(), config.get_num_of_threads()));
 
-	// read in saved generation
-	std::size_t saved_generation;
-	in >> saved_generation;
+	// skip saved generation num
+	in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
 	// read in cell states
 	std::size_t column = 0, row = 0;
@@ -155,27 +450,55 @@ bool Core::load(const std::string& file)
 
 	// set current generation to read generation
 	generation = saved_generation;
+	reset_history();
 	// calc next generation
 	system_->calc_next_generation();
+	replace_failed_stripes();
 
 	// return true on success
 	return true;
 }
 
+HashLife_System* Core::new_hashlife_system(std::size_t survival_rules, std::size_t rebirth_rules)
+{
+	HashLife_System* hashlife = new HashLife_System(survival_rules, rebirth_rules, config.get_num_of_threads());
+	hashlife->set_symmetric(config.get_hashlife_symmetry());
+	if(!config.get_hashlife_store().empty())
+		hashlife->open_store(config.get_hashlife_store(), config.get_hashlife_store_size() << 20);
+
+	return hashlife;
+}
+
 void Core::new_system()
 {
+	// release previous system first; a Stripe_System has to stop its worker processes
+	system_.reset();
+
 	if(config.get_border_behavior() == Border_Behavior::Borderless)
-		system_.reset(new HashLife_System(config.get_survival_rules(), config.get_rebirth_rules()));
+		system_.reset(new_hashlife_system(config.get_survival_rules(), config.get_rebirth_rules()));
+	else if(config.get_num_of_processes() > 1)
+	{
+		Stripe_System* stripes = new Stripe_System(config.get_size_x(), config.get_size_y(), config.get_border_behavior(),
+												   config.get_survival_rules(), config.get_rebirth_rules(), config.get_num_of_processes());
+		system_.reset(stripes);
+
+		// use single process algorithm if processes could not be started
+		if(!stripes->is_valid())
+			system_.reset(new Cell_System(config.get_size_x(), config.get_size_y(), config.get_border_behavior(),
+									config.get_survival_rules(), config.get_rebirth_rules(), config.get_num_of_threads()));
+	}
 	else
 		system_.reset(new Cell_System(config.get_size_x(), config.get_size_y(), config.get_border_behavior(),
-								config.get_survival_rules(), config.get_rebirth_rules(), config.get_num_of_threads()));
+								config.get_survival_rules(), config.get_rebirth_rules(), config.get_num_of_threads(), config.get_mapping_file()));
 
 	if(config.get_start_random())
 		system_->random_cells(config.get_relation_alive(), config.get_relation_dead());
 	generation = 0;
+	replace_failed_stripes();
+	reset_history();
 }
 
-std::size_t Core::get_num_of_alive_cells()
+Big_Integer Core::get_num_of_alive_cells()
 {
 	auto temp = dynamic_cast<HashLife_System*>(system_.get());
 	if(temp)
@@ -184,10 +507,16 @@ std::size_t Core::get_num_of_alive_cells()
 		return 0;
 }
 
+HashLife_System* Core::get_hashlife_system()
+{
+	return dynamic_cast<HashLife_System*>(system_.get());
+}
+
 bool Core::expand()
 {
 	auto temp = dynamic_cast<HashLife_System*>(system_.get());
-	if(temp)
+	// the visible cells of HashLife cannot grow beyond its window
+	if(temp && temp->get_level() < HashLife_System::max_coordinate_level)
 		temp->resize(temp->get_size_x() * 2);
 	else
 		return false;
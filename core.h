@@ -5,8 +5,12 @@
 
 #include "configuration.h"
 #include "basesystem.h"
+#include "biginteger.h"
+#include "generationhistory.h"
 #include <memory>
 
+class HashLife_System;
+
 // singleton class: to get the instance call Core::get_instance()
 // this core contains all non-graphic and basic operations and manage cells
 // the class is completely written in standard C++ (filesystem support required) and can also be used in a GUI-less application
@@ -16,24 +20,54 @@ class Core
 	static Configuration config;
 
 	static std::unique_ptr<Base_System> system_;
-	static std::size_t generation;
+	static Big_Integer generation;
+
+	// previous generations; limits are set by Configuration::history_size and Configuration::keyframe_interval
+	static Generation_History history;
+
+	// clear history and apply limits of configuration
+	static void reset_history();
+	// release unreachable macrocells of HashLife system if Configuration::hashlife_memory is exceeded; the current root and the history roots are kept
+	static void collect_garbage(HashLife_System* system);
+	// create HashLife system with given rules; it uses the store of Configuration::hashlife_store if it is set and Configuration::hashlife_symmetry
+	static HashLife_System* new_hashlife_system(std::size_t survival_rules, std::size_t rebirth_rules);
+	// replace a Stripe_System whose worker process terminated by a Cell_System with the same cells; the game is continued by one process
+	static void replace_failed_stripes();
 
 public:
 	// create new game with set configuration
 	// if Configuration::start_random is true, the game board will be filled with random cells; the ratio is given by Configuration::relation_dead/Configuration::relation_alive
 	static void new_system();
 
-	// save current game to file
+	// save current game to file; if the file ends on ".golm", a checkpoint of a bounded game is written (header + both states)
+	// if the file ends on ".mc", the macrocells of a HashLife game are written in the format of Golly (rule, generation and each distinct macrocell once)
 	static bool save(const std::string& file);
 	// load given file; the file must contain a valid format (0=dead, 1=alive, \n=next_row, space=ignored); file must end on ".gol", otherwise false will be returned
+	// files ending on ".golm" are checkpoints; they are memory-mapped, so the cells are not read in; each generation is written into the mapped file
+	// if Configuration::mapping_file is set, the checkpoint is copied to it and the copy is mapped; otherwise the loaded file becomes the live game and is overwritten by the next generation
+	// files ending on ".mc" are macrocell files (e.g. of Golly); they are continued by HashLife with the rule of the file, the configuration is not changed
 	static bool load(const std::string& file);
 
-	// update to next generation and calculate next states
-	static std::size_t next_generation(std::size_t generations = 1);
+	// update to next generation and calculate next states; return num of advanced generations (only HashLife advances more than 2^64 - 1 generations at once)
+	// if lookahead is false, HashLife does not calculate the next states (they are not shown while generating); call calc_next_generation() before they are read
+	static Big_Integer next_generation(const Big_Integer& generations = 1, bool lookahead = true);
 	// calculate next states without updating cells
-	static void calc_next_generation(std::size_t generations = 1);
+	static void calc_next_generation(const Big_Integer& generations = 1);
+	// calculate next states of given rectangle if they are not calculated yet; HashLife calculates only the light cone of the rectangle (see HashLife_System::calc_next_region())
+	// unless it covers the whole universe; the other systems always calculate all next states, so nothing is done for them
+	static void calc_next_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, const Big_Integer& generations = 1);
+	// advance one step of hyperspeed, whose step size adapts to the hit rate of HashLife and given budget (µs; see HashLife_System::next_hyperspeed_step())
+	// other systems advance one generation; return num of advanced generations
+	static Big_Integer next_hyperspeed_step(std::size_t budget, bool lookahead = true);
+
+	// restore the newest recorded generation in front of the current generation and calculate its next state; return false if there is none
+	static bool previous_generation();
+	// restore the newest recorded generation which is lower than or equal to given generation and calculate its next state; return false if there is none
+	static bool rewind(const Big_Integer& generation);
 
-	static std::size_t get_num_of_alive_cells();
+	static Big_Integer get_num_of_alive_cells();
+	// return current system if HashLife is used; otherwise return nullptr
+	static HashLife_System* get_hashlife_system();
 	static bool expand();
 
 // set member
@@ -41,12 +75,12 @@ public:
 	// set one cell at given position to given state; the next state is not calculated; to do this call calc_next_generation()
 	static inline void set_cell_state(std::size_t x, std::size_t y, Cell_State state)
 	{
-		system_->set_cell(x, y, state);
+		system_->set_cell(x, y, state); history.invalidate();
 	}
 	// set all cells to given state; the next state is already calculated, no call of calc_next_generation() required
 	static inline void reset_cells(Cell_State state = Dead)
 	{
-		system_->set_all(state); generation = 0;
+		system_->set_all(state); generation = 0; history.clear();
 	}
 // get member
 public:
@@ -62,6 +96,11 @@ public:
 	{
 		return system_->get_next_cell_state(x, y);
 	}
+	// copy states of given rectangle into given buffers (see Base_System::get_cell_states()); next may be nullptr
+	static inline void get_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, Cell_State* current, Cell_State* next = nullptr)
+	{
+		system_->get_cell_states(x, y, width, height, current, next);
+	}
 	static inline std::size_t get_size_x()
 	{
 		return system_->get_size_x();
@@ -70,10 +109,14 @@ public:
 	{
 		return system_->get_size_y();
 	}
-	static inline std::size_t get_generation()
+	static inline const Big_Integer& get_generation()
 	{
 		return generation;
 	}
+	static inline const Generation_History* get_history()
+	{
+		return &history;
+	}
 };
 
 #endif // CORE_H
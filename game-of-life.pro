@@ -19,6 +19,9 @@ msvc {
 gcc {
 	LIBS += -lstdc++fs
 }
+unix {
+	LIBS += -lpthread
+}
 
 
 SOURCES += \
@@ -36,7 +39,15 @@ SOURCES += \
     startupdialog.cpp \
     hashlifesystem.cpp \
     hashlifemacrocell.cpp \
-    hashlifetable.cpp
+    hashlifetable.cpp \
+    hashlifearena.cpp \
+    hashlifestore.cpp \
+    halotransport.cpp \
+    stripesystem.cpp \
+    taskpool.cpp \
+    mappedbuffer.cpp \
+    generationhistory.cpp \
+    biginteger.cpp
 
 HEADERS += \
     mainwindow.h \
@@ -53,7 +64,15 @@ HEADERS += \
     startupdialog.h \
     hashlifesystem.h \
     hashlifemacrocell.h \
-    hashlifetable.h
+    hashlifetable.h \
+    hashlifearena.h \
+    hashlifestore.h \
+    halotransport.h \
+    stripesystem.h \
+    taskpool.h \
+    mappedbuffer.h \
+    generationhistory.h \
+    biginteger.h
 
 RESOURCES += \
     resources.qrc
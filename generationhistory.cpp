@@ -0,0 +1,372 @@
+// © Copyright (c) 2018 SqYtCO
+
+#include "generationhistory.h"
+#include "hashlifesystem.h"
+
+// append num as variable-length integer (7 bits per byte, highest bit marks continuation)
+static inline void write_varint(std::vector<unsigned char>& out, std::size_t num)
+{
+	while(num >= 0x80)
+	{
+		out.push_back(static_cast<unsigned char>(num | 0x80));
+		num >>= 7;
+	}
+	out.push_back(static_cast<unsigned char>(num));
+}
+
+// read variable-length integer at pos and move pos behind it
+static inline std::size_t read_varint(const std::vector<unsigned char>& in, std::size_t& pos)
+{
+	std::size_t num = 0;
+	for(std::size_t shift = 0; ; shift += 7)
+	{
+		unsigned char byte = in[pos++];
+		num |= static_cast<std::size_t>(byte & 0x7F) << shift;
+		if(!(byte & 0x80))
+			return num;
+	}
+}
+
+// encode differences of two states as distances between changed cells
+static void encode_delta(const std::vector<Cell_State>& previous, const std::vector<Cell_State>& current, std::vector<unsigned char>& out)
+{
+	std::size_t next = 0;
+	for(std::size_t i = 0; i < current.size(); ++i)
+		if(previous[i] != current[i])
+		{
+			write_varint(out, i - next);
+			next = i + 1;
+		}
+}
+
+// toggle all cells which are contained in given delta; append their positions to changed
+static void apply_delta(const std::vector<unsigned char>& delta, std::vector<Cell_State>& state, std::vector<std::size_t>& changed)
+{
+	std::size_t pos = 0, cell = 0;
+	while(pos < delta.size())
+	{
+		cell += read_varint(delta, pos);
+		state[cell] ^= Alive;
+		changed.push_back(cell++);
+	}
+}
+
+// encode state as alternating run lengths of dead and alive cells (beginning with dead cells)
+static void encode_keyframe(const std::vector<Cell_State>& state, std::vector<unsigned char>& out)
+{
+	Cell_State run_state = Dead;
+	std::size_t run_length = 0;
+	for(const auto& a : state)
+	{
+		if(a != run_state)
+		{
+			write_varint(out, run_length);
+			run_state = a;
+			run_length = 0;
+		}
+		++run_length;
+	}
+	write_varint(out, run_length);
+}
+
+static void decode_keyframe(const std::vector<unsigned char>& keyframe, std::vector<Cell_State>& state)
+{
+	std::size_t pos = 0, cell = 0;
+	Cell_State run_state = Dead;
+	while(pos < keyframe.size())
+	{
+		std::size_t run_length = read_varint(keyframe, pos);
+		for(std::size_t end = cell + run_length; cell < end; ++cell)
+			state[cell] = run_state;
+		run_state ^= Alive;
+	}
+}
+
+Generation_History::Generation_History() : cursor(0), synced(false), size_x(0), size_y(0), memory_limit(0), keyframe_interval(1), memory_usage(0), since_keyframe(0)
+{	}
+
+std::size_t Generation_History::get_entry_size(const Entry& entry)
+{
+	return sizeof(Entry) + entry.delta.capacity() + entry.keyframe.capacity();
+}
+
+void Generation_History::set_limits(std::size_t memory_limit, std::size_t keyframe_interval)
+{
+	this->memory_limit = memory_limit;
+	this->keyframe_interval = (keyframe_interval != 0) ? keyframe_interval : 1;
+
+	if(memory_limit == 0)
+		clear();
+	else
+		enforce_limit();
+}
+
+void Generation_History::clear()
+{
+	entries.clear();
+	cursor_state.clear();
+	cursor_state.shrink_to_fit();
+	cursor = 0;
+	synced = false;
+	size_x = size_y = 0;
+	memory_usage = 0;
+	since_keyframe = 0;
+}
+
+void Generation_History::move_cursor(std::size_t index, std::vector<std::size_t>& changed, bool& full_update)
+{
+	// step back: deltas are symmetric (XOR)
+	while(cursor > index)
+		apply_delta(entries[cursor--].delta, cursor_state, changed);
+
+	if(cursor == index)
+		return;
+
+	// step forward; start at the newest keyframe in between if there is one
+	std::size_t keyframe = index;
+	while(keyframe > cursor && entries[keyframe].keyframe.empty())
+		--keyframe;
+	if(keyframe > cursor)
+	{
+		decode_keyframe(entries[keyframe].keyframe, cursor_state);
+		cursor = keyframe;
+		full_update = true;
+	}
+
+	while(cursor < index)
+		apply_delta(entries[++cursor].delta, cursor_state, changed);
+}
+
+void Generation_History::truncate(std::size_t index)
+{
+	if(index == 0)
+	{
+		clear();
+		return;
+	}
+
+	// cursor has to point to the last remaining entry, because new deltas are based on it
+	std::vector<std::size_t> changed;
+	bool full_update = false;
+	if(cursor != index - 1)
+	{
+		move_cursor(index - 1, changed, full_update);
+		synced = false;
+	}
+
+	while(entries.size() > index)
+	{
+		memory_usage -= get_entry_size(entries.back());
+		entries.pop_back();
+	}
+
+	// count entries since last keyframe again
+	since_keyframe = 0;
+	for(std::size_t i = entries.size(); i-- > 0 && entries[i].keyframe.empty(); )
+		++since_keyframe;
+}
+
+void Generation_History::enforce_limit()
+{
+	// the entry of the cursor is never removed, because cursor_state depends on it
+	while(memory_usage > memory_limit && entries.size() > 1 && cursor > 0)
+	{
+		Entry& second = entries[1];
+
+		// second entry becomes first entry, so it has to be a keyframe (dense systems)
+		if(second.root == nullptr && second.keyframe.empty())
+		{
+			std::vector<Cell_State> state(size_x * size_y);
+			std::vector<std::size_t> changed;
+			decode_keyframe(entries.front().keyframe, state);
+			apply_delta(second.delta, state, changed);
+
+			memory_usage -= get_entry_size(second);
+			encode_keyframe(state, second.keyframe);
+			second.keyframe.shrink_to_fit();
+			memory_usage += get_entry_size(second);
+		}
+
+		memory_usage -= get_entry_size(entries.front());
+		entries.pop_front();
+
+		// the delta of the first entry is never used
+		memory_usage -= get_entry_size(entries.front());
+		entries.front().delta.clear();
+		entries.front().delta.shrink_to_fit();
+		memory_usage += get_entry_size(entries.front());
+
+		--cursor;
+	}
+}
+
+void Generation_History::record(const Big_Integer& generation, Base_System* system, bool generating)
+{
+	if(memory_limit == 0)
+		return;
+
+	// state is already recorded
+	if(synced && !entries.empty() && entries[cursor].generation == generation)
+		return;
+
+	HashLife_System* hashlife = dynamic_cast<HashLife_System*>(system);
+	if(!hashlife)
+	{
+		// the decoded state of the cursor alone has to fit the limit
+		if(system->get_size_x() * system->get_size_y() * sizeof(Cell_State) > memory_limit)
+		{
+			clear();
+			return;
+		}
+		// the following generations are compared with the cursor entry, so skipped states only increase the next delta
+		if(generating && !entries.empty() && entries[cursor].generation <= generation && generation - entries[cursor].generation < generating_interval)
+			return;
+	}
+
+	// replace entries with same or higher generation
+	std::size_t index = entries.size();
+	while(index > 0 && entries[index - 1].generation >= generation)
+		--index;
+	truncate(index);
+
+	Entry entry;
+	entry.generation = generation;
+	entry.root = nullptr;
+	entry.level = 0;
+
+	if(hashlife)
+	{
+		// macrocells are immutable, so the root represents the whole state
+		entry.root = hashlife->get_master_cell();
+		entry.level = hashlife->get_level();
+	}
+	else
+	{
+		// a system with another size can not be compared
+		if(!entries.empty() && (size_x != system->get_size_x() || size_y != system->get_size_y()))
+			truncate(0);
+
+		size_x = system->get_size_x();
+		size_y = system->get_size_y();
+
+		std::vector<Cell_State> state(size_x * size_y);
+		system->get_cell_states(0, 0, size_x, size_y, state.data());
+
+		if(!entries.empty())
+			encode_delta(cursor_state, state, entry.delta);
+		if(entries.empty() || since_keyframe + 1 >= keyframe_interval)
+			encode_keyframe(state, entry.keyframe);
+
+		entry.delta.shrink_to_fit();
+		entry.keyframe.shrink_to_fit();
+		memory_usage -= cursor_state.capacity() * sizeof(Cell_State);
+		cursor_state = std::move(state);
+		memory_usage += cursor_state.capacity() * sizeof(Cell_State);
+	}
+
+	since_keyframe = entry.keyframe.empty() ? since_keyframe + 1 : 0;
+	memory_usage += get_entry_size(entry);
+	entries.push_back(std::move(entry));
+	cursor = entries.size() - 1;
+	synced = true;
+
+	enforce_limit();
+}
+
+bool Generation_History::restore(const Big_Integer& generation, Base_System* system, Big_Integer& restored_generation)
+{
+	// find newest entry with a generation lower than or equal to given generation
+	std::size_t index = entries.size();
+	while(index > 0 && entries[index - 1].generation > generation)
+		--index;
+	if(index == 0)
+		return false;
+	--index;
+
+	Entry& entry = entries[index];
+	if(entry.root)
+	{
+		HashLife_System* hashlife = dynamic_cast<HashLife_System*>(system);
+		if(!hashlife)
+			return false;
+
+		hashlife->set_master_cell(entry.root, entry.level);
+		cursor = index;
+	}
+	else
+	{
+		if(size_x != system->get_size_x() || size_y != system->get_size_y())
+			return false;
+
+		std::vector<std::size_t> changed;
+		bool full_update = !synced;
+		move_cursor(index, changed, full_update);
+
+		// write only changed cells if the system was equal to the previous cursor
+		if(full_update)
+		{
+			for(std::size_t y = 0; y < size_y; ++y)
+				for(std::size_t x = 0; x < size_x; ++x)
+					system->set_cell(x, y, cursor_state[y * size_x + x]);
+		}
+		else
+		{
+			for(const auto& a : changed)
+				system->set_cell(a % size_x, a / size_x, cursor_state[a]);
+		}
+	}
+
+	synced = true;
+	restored_generation = entry.generation;
+	return true;
+}
+
+bool Generation_History::restore_previous(const Big_Integer& current_generation, Base_System* system, Big_Integer& restored_generation)
+{
+	if(current_generation.is_zero())
+		return false;
+
+	return restore(current_generation - 1, system, restored_generation);
+}
+
+void Generation_History::advanced(const Big_Integer& generation)
+{
+	// keep following entries if the system reached the next recorded state (redo)
+	if(synced && cursor + 1 < entries.size() && entries[cursor + 1].generation == generation)
+	{
+		if(entries[cursor + 1].root == nullptr)
+		{
+			std::vector<std::size_t> changed;
+			bool full_update = false;
+			move_cursor(cursor + 1, changed, full_update);
+		}
+		else
+			++cursor;
+	}
+	else
+		synced = false;
+}
+
+void Generation_History::get_roots(std::vector<Macrocell_Ref>& roots) const
+{
+	for(const auto& a : entries)
+		if(a.root)
+			roots.push_back(a.root);
+}
+
+bool Generation_History::drop_oldest_roots()
+{
+	// the entry of the cursor is kept
+	const std::size_t count = (cursor + 1) / 2;
+	if(count == 0 || entries.front().root == nullptr)
+		return false;
+
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		memory_usage -= get_entry_size(entries.front());
+		entries.pop_front();
+	}
+	cursor -= count;
+
+	return true;
+}
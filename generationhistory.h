@@ -0,0 +1,92 @@
+// © Copyright (c) 2018 SqYtCO
+
+#ifndef GENERATIONHISTORY_H
+#define GENERATIONHISTORY_H
+
+#include "basesystem.h"
+#include "biginteger.h"
+#include "hashlifearena.h"
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+/* history of previous generations with bounded memory usage
+ * each recorded generation of a dense system (Cell_System, Stripe_System) is stored as XOR delta to the previously recorded generation; the delta contains the distances between changed cells (run-length encoded)
+ * every keyframe_interval entries additionally a keyframe is stored, which contains the run lengths of equal cells of the whole state
+ * for HashLife only the root macrocell is stored, because all macrocells are immutable
+ * the decoded state of one entry (cursor) is kept, so stepping to a neighboring entry only requires to apply one delta */
+class Generation_History
+{
+	struct Entry
+	{
+		Big_Integer generation;
+		std::vector<unsigned char> delta;		// changed cells compared to previous entry; empty for the first entry
+		std::vector<unsigned char> keyframe;	// complete state; empty if entry is no keyframe
+		Macrocell_Ref root;						// root of HashLife system; nullptr for dense systems
+		std::size_t level;						// level of root
+	};
+
+	std::deque<Entry> entries;
+	std::size_t cursor;							// index of entry whose state is stored in cursor_state
+	std::vector<Cell_State> cursor_state;		// decoded state of entries[cursor] (dense systems)
+	bool synced;								// true if the state of the system is equal to entries[cursor]
+
+	std::size_t size_x;							// size of recorded dense states
+	std::size_t size_y;
+
+	std::size_t memory_limit;					// max. memory usage in bytes; 0 disables recording
+	std::size_t keyframe_interval;				// num of entries between keyframes
+	std::size_t memory_usage;					// currently used memory in bytes (including cursor_state)
+	std::size_t since_keyframe;					// num of entries since last keyframe
+
+	// while generating, dense states are recorded only every generating_interval generations, because each record compares the whole state
+	static constexpr std::size_t generating_interval = 16;
+
+	// return memory used by given entry
+	static std::size_t get_entry_size(const Entry& entry);
+
+	// set cursor_state to state of given entry by applying deltas starting at the current cursor or at a keyframe; positions of changed cells are appended to changed
+	// if a keyframe was decoded, full_update is set to true
+	void move_cursor(std::size_t index, std::vector<std::size_t>& changed, bool& full_update);
+	// remove all entries beginning at given index; the cursor is moved in front of index
+	void truncate(std::size_t index);
+	// remove oldest entries until memory_usage fits memory_limit; the oldest remaining entry is converted into a keyframe if necessary
+	void enforce_limit();
+
+public:
+	Generation_History();
+
+	// set max. memory usage in bytes (0 disables history) and num of entries between keyframes; existing entries are kept
+	void set_limits(std::size_t memory_limit, std::size_t keyframe_interval);
+	// remove all entries
+	void clear();
+
+	// store state of given system as given generation if it is not already stored; entries with the same or higher generations are replaced
+	// if generating is true, a dense state is skipped if the cursor entry is less than generating_interval generations older; a state which does not fit memory_limit clears the history
+	void record(const Big_Integer& generation, Base_System* system, bool generating = false);
+	// restore newest entry with a generation lower than or equal to given generation into given system; return restored generation
+	// return false if no such entry exists; the next state of the system has to be calculated afterwards
+	bool restore(const Big_Integer& generation, Base_System* system, Big_Integer& restored_generation);
+	// restore entry in front of the current state; return false if no previous entry exists
+	bool restore_previous(const Big_Integer& current_generation, Base_System* system, Big_Integer& restored_generation);
+
+	// has to be called after the system was updated to the given generation; if the entry after the cursor contains this generation, it is kept as current state
+	void advanced(const Big_Integer& generation);
+	// has to be called if cells were changed without calling record()
+	inline void invalidate() { synced = false; }
+
+	// append all stored HashLife roots to given vector (they must not be collected)
+	void get_roots(std::vector<Macrocell_Ref>& roots) const;
+	// remove the oldest half of the HashLife entries in front of the cursor; their macrocells can be collected afterwards
+	// return false if no entry was removed; the memory usage of an entry does not contain its macrocells, so this is used if they exceed Configuration::hashlife_memory
+	bool drop_oldest_roots();
+
+// get members
+	inline bool empty() const { return entries.empty(); }
+	inline Big_Integer get_oldest_generation() const { return entries.empty() ? 0 : entries.front().generation; }
+	inline Big_Integer get_newest_generation() const { return entries.empty() ? 0 : entries.back().generation; }
+	inline std::size_t get_memory_usage() const { return memory_usage; }
+	inline std::size_t get_num_of_entries() const { return entries.size(); }
+};
+
+#endif // GENERATIONHISTORY_H
@@ -37,6 +37,7 @@ void GraphicConfiguration::GraphicConfiguration::reset_config()
 	lock_after_first_generating = Default_Values::LOCK_AFTER_FIRST_GENERATING;
 	left_button_alive_right_dead = Default_Values::LEFT_ALIVE_AND_RIGHT_DEAD;
 	generations_per_step = Default_Values::GENERATIONS_PER_STEP;
+	hyperspeed = Default_Values::HYPERSPEED;
 	show_startup_dialog = Default_Values::SHOW_STARTUP_DIALOG;
 	delay = Default_Values::DELAY;
 	save_path = Default_Values::SAVE_PATH;
@@ -90,6 +91,8 @@ bool GraphicConfiguration::read_config()
 			left_button_alive_right_dead = std::stoul(value);
 		else if(property == "generations_per_step")
 			generations_per_step = std::stoul(value);
+		else if(property == "hyperspeed")
+			hyperspeed = std::stoul(value);
 		else if(property == "show_startup_dialog")
 			show_startup_dialog = std::stoul(value);
 		else if(property == "delay")
@@ -142,6 +145,7 @@ bool GraphicConfiguration::write_config()
 	<< "lock_after_first_generating=" << lock_after_first_generating << '\n'
 	<< "left_button_alive_right_dead=" << left_button_alive_right_dead << '\n'
 	<< "generations_per_step=" << generations_per_step << '\n'
+	<< "hyperspeed=" << hyperspeed << '\n'
 	<< "show_startup_dialog=" << show_startup_dialog << '\n'
 	<< "delay=" << delay << '\n'
 	<< "save_path=" << save_path;
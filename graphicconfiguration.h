@@ -32,6 +32,7 @@ namespace Default_Values
 	constexpr bool LOCK_AFTER_FIRST_GENERATING = false;
 	constexpr bool LEFT_ALIVE_AND_RIGHT_DEAD = true;
 	constexpr std::size_t GENERATIONS_PER_STEP = 1;
+	constexpr bool HYPERSPEED = false;
 	constexpr bool SHOW_STARTUP_DIALOG = true;
 	constexpr std::size_t DELAY = 15;
 	constexpr const char* SAVE_PATH = "gol_saves/";
@@ -81,6 +82,7 @@ private:
 	bool left_button_alive_right_dead;			// if true, the left mouse button makes cells alive and the right mouse button makes cells dead; if false, the behavior is inverted;
 											//		config will be saved automatically after changing
 	std::size_t generations_per_step;		// generations per step; if >1 some generations will calculated but not displayed; config will be saved automatically after changing
+	bool hyperspeed;						// if true, HashLife adapts the num of generations per frame while autogenerating (see Core::next_hyperspeed_step())
 	bool show_startup_dialog;				// if true, a startup dialog is shown; config will be saved automatically after changing
 	std::size_t delay;						// delay between generations while autogenerating is running
 	std::string save_path;					// default path for saved games; string has to end with a separator
@@ -102,6 +104,7 @@ public:
 	inline void set_lock_after_first_generating(const bool& new_lock_after_first_generating) { config_saved = false; lock_after_first_generating = new_lock_after_first_generating; }
 	inline void set_left_button_alive_right_dead(const bool& new_left_button_alive_right_dead) { left_button_alive_right_dead = new_left_button_alive_right_dead; write_config(); }
 	inline void set_generations_per_step(std::size_t new_generations_per_step) { generations_per_step = new_generations_per_step; write_config(); }
+	inline void set_hyperspeed(const bool& new_hyperspeed) { config_saved = false; hyperspeed = new_hyperspeed; }
 	inline void set_show_startup_dialog(const bool& new_show_startup_dialog) { show_startup_dialog = new_show_startup_dialog; write_config(); }
 	inline void set_delay(std::size_t new_delay) { config_saved = false; delay = new_delay; }
 	inline void set_save_path(const std::string& new_save_path) { config_saved = false; save_path = new_save_path; }
@@ -123,6 +126,7 @@ public:
 	inline const bool& get_lock_after_first_generating() const { return lock_after_first_generating; }
 	inline const bool& get_left_button_alive_right_dead() const { return left_button_alive_right_dead; }
 	inline std::size_t get_generations_per_step() const { return generations_per_step; }
+	inline const bool& get_hyperspeed() const { return hyperspeed; }
 	inline const bool& get_show_startup_dialog() const { return show_startup_dialog; }
 	inline std::size_t get_delay() const { return delay; }
 	inline const std::string& get_save_path() const { return save_path; }
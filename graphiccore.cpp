@@ -90,7 +90,7 @@ void GraphicCore::update_generation_counter()
 {
 	gen_counter->setVisible(!gconfig.get_hide_generation_counter());
 	gen_counter->setFont(QFont("", static_cast<int>(get_config()->get_generation_counter_size())));
-	gen_counter->setText(QString::number(Core::get_generation()));
+	gen_counter->setText(QString::fromStdString(Core::get_generation().to_string()));
 }
 
 void GraphicCore::update_opengl()
@@ -101,7 +101,7 @@ void GraphicCore::update_opengl()
 void GraphicCore::read_save()
 {
 	QString selected_filter("Game of Life(*.gol)");
-	Core::load(QFileDialog::getOpenFileName(nullptr, QFileDialog::tr("Select a file to open..."), GraphicCore::get_config()->get_save_path().c_str(), QFileDialog::tr("All Files(*);;Game of Life(*.gol)"), &selected_filter).toStdString());
+	Core::load(QFileDialog::getOpenFileName(nullptr, QFileDialog::tr("Select a file to open..."), GraphicCore::get_config()->get_save_path().c_str(), QFileDialog::tr("All Files(*);;Game of Life(*.gol);;Game of Life Checkpoint(*.golm);;Macrocell(*.mc)"), &selected_filter).toStdString());
 	update_opengl();
 	update_generation_counter();
 }
@@ -110,7 +110,7 @@ void GraphicCore::write_save_as()
 {
 	// ask for file name
 	QString selected_filter("Game of Life(*.gol)");
-	QString file_name = QFileDialog::getSaveFileName(nullptr, QFileDialog::tr("Choose a file name to save..."), GraphicCore::get_config()->get_save_path().c_str(), QFileDialog::tr("All Files(*);;Game of Life(*.gol)"), &selected_filter);
+	QString file_name = QFileDialog::getSaveFileName(nullptr, QFileDialog::tr("Choose a file name to save..."), GraphicCore::get_config()->get_save_path().c_str(), QFileDialog::tr("All Files(*);;Game of Life(*.gol);;Game of Life Checkpoint(*.golm);;Macrocell(*.mc)"), &selected_filter);
 
 	// return if no file name was entered
 	if(file_name.isEmpty())
@@ -145,13 +145,15 @@ void GraphicCore::write_save()
 
 		// attached num if file exists already
 		std::size_t save_num = 0;
+		// HashLife games are saved as macrocells; their size depends on the distinct macrocells instead of the area
+		const std::string extension = (Core::get_hashlife_system()) ? ".mc" : ".gol";
 		while(true)
 		{
 			// first try without num
 			if(save_num == 0)
-				file = gconfig.get_save_path() + date + ".gol";
+				file = gconfig.get_save_path() + date + extension;
 			else
-				file = gconfig.get_save_path() + date + "_" + std::to_string(save_num) + ".gol";
+				file = gconfig.get_save_path() + date + "_" + std::to_string(save_num) + extension;
 
 			// check if file exists already
 			std::ifstream in(file);
@@ -182,11 +184,12 @@ void GraphicCore::next_generations(std::size_t generations)
 		{
 			{
 				std::lock_guard<decltype(system_mutex)> lock(system_mutex);
-				generations -= Core::next_generation(generations);
+				generations -= Core::next_generation(generations, false).to_size_t();
 			}
 		}
 	}
 
+	// HashLife calculates the next states of the shown generation when they are drawn (only the visible cells; see Core::calc_next_states())
 	stepping_stop = true;
 
 	// send signals to main thread (update GUI)
@@ -213,11 +216,32 @@ void GraphicCore::stop_step()
 	stepping_stop = true;
 	if(stepping_thread)
 	{
+		// a long HashLife step is cancelled instead of finished; its completed results are kept
+		HashLife_System* hashlife = Core::get_hashlife_system();
+		if(hashlife)
+			hashlife->cancel_calculation(true);
 		stepping_thread->join();
 		stepping_thread.reset(nullptr);
+		if(hashlife)
+			hashlife->cancel_calculation(false);
 	}
 }
 
+void GraphicCore::previous_generation()
+{
+	stop_generating();
+	stop_step();
+	wait_for_calculation();
+
+	{
+		std::lock_guard<decltype(system_mutex)> lock(system_mutex);
+		Core::previous_generation();
+	}
+
+	update_generation_counter();
+	update_opengl();
+}
+
 void GraphicCore::start_generating()
 {
 	if(generating_running())
@@ -242,16 +266,31 @@ void GraphicCore::start_generating()
 #endif
 			{
 				std::lock_guard<decltype(system_mutex)> lock(system_mutex);
-				Core::next_generation();
+				// next states are not shown while generating
+				if(gconfig.get_hyperspeed())
+					Core::next_hyperspeed_step(hyperspeed_budget, false);
+				else
+					Core::next_generation(1, false);
 			}
 #ifdef ENABLE_CALC_TIME_MEASUREMENT
 			auto end = std::chrono::high_resolution_clock::now();
 			qDebug() << "calculating: " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << "µs";
+			// report garbage collection of macrocells which was triggered by this generation
+			static std::size_t num_of_collections = 0;
+			if(Macrocell::hash_table.get_num_of_collections() != num_of_collections)
+			{
+				num_of_collections = Macrocell::hash_table.get_num_of_collections();
+				qDebug() << "garbage collection: " << Macrocell::hash_table.get_last_collection_time() << "µs, "
+						 << (Macrocell::hash_table.get_last_reclaimed() >> 10) << "KiB reclaimed";
+			}
 #endif
 
 			emit opengl->cell_changed();
 			emit opengl->start_update();
 		}
+
+		// HashLife calculates the next states of the last generation when they are drawn after stopping
+		emit opengl->start_update();
 	}));
 
 	emit opengl->generating_start_stop();
@@ -279,6 +318,13 @@ void GraphicCore::calc_next_generation()
 
 	wait_for_calculation();
 
+	// HashLife calculates the next states of the visible cells when they are drawn
+	if(Core::get_hashlife_system())
+	{
+		update_opengl();
+		return;
+	}
+
 	calc_thread.reset(new std::thread([]()
 	{
 		{
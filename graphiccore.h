@@ -46,6 +46,9 @@ class GraphicCore
 
 	static std::mutex system_mutex;
 
+	// time of one step of hyperspeed in µs; the step size grows while steps take less than half of it
+	static constexpr std::size_t hyperspeed_budget = 20000;
+
 	static void next_generations(std::size_t generations);
 
 public:
@@ -78,6 +81,8 @@ public:
 	static void step();
 	// interrupt calculation of step
 	static void stop_step();
+	// stop autogenerating and stepping and restore previous generation from history
+	static void previous_generation();
 	// return true if calculation of step is running
 	static bool step_running() { return !stepping_stop; }
 	// block any new attempt to start calculation of step if true
@@ -0,0 +1,250 @@
+// © Copyright (c) 2018 SqYtCO
+
+#include "halotransport.h"
+
+#ifdef ENABLE_SHARED_MEMORY_TRANSPORT
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+#include <new>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+
+// control data shared by all ranks; placed at the begin of the shared mapping
+// the barrier uses only lock-free atomics, so a terminated rank can not leave a lock or a condition variable in an inconsistent state
+struct Shared_Control_Block
+{
+	std::atomic<uint32_t> num_of_waiting;			// num of ranks which arrived at the current barrier
+	std::atomic<uint32_t> num_of_barriers;			// num of completed barriers; a waiting rank leaves if it changes (futex word)
+	std::atomic<bool> abandoned;					// true if a rank terminated; all following barriers fail
+	Stripe_Command command;							// last sent command
+	std::size_t argument;							// argument of last sent command
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free, "futex word has to be a plain 32-bit integer");
+
+// max. time of one wait; rank 0 checks its workers afterwards
+static constexpr long poll_interval_ns = 100000000;
+
+// wait until given word differs from given value, it is woken or the poll interval elapsed; return true if the poll interval elapsed
+static bool wait_for_change(std::atomic<uint32_t>& word, uint32_t value)
+{
+#ifdef __linux__
+	timespec timeout{ 0, poll_interval_ns };
+	return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, value, &timeout, nullptr, 0) != 0 && errno == ETIMEDOUT;
+#else
+	// without futexes the word is polled
+	static constexpr long sleep_ns = 50000;
+	static_cast<void>(value);
+	timespec pause{ 0, sleep_ns };
+	nanosleep(&pause, nullptr);
+	return word.load(std::memory_order_relaxed) == value;
+#endif
+}
+
+// wake all ranks waiting for a change of given word
+static void wake_all(std::atomic<uint32_t>& word)
+{
+#ifdef __linux__
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+	static_cast<void>(word);
+#endif
+}
+
+// round up to a multiple of the cache line size to avoid false sharing between the areas
+static inline std::size_t align_size(std::size_t size)
+{
+	constexpr std::size_t alignment = 64;
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+Shared_Memory_Transport::Shared_Memory_Transport(std::size_t num_of_ranks, std::size_t row_size, std::size_t stripe_size, bool periodic)
+	: num_of_ranks(num_of_ranks), row_size(row_size), stripe_size(stripe_size), periodic(periodic), mapping(nullptr), mapping_size(0),
+	  control(nullptr), halo_slots(nullptr), stripes(nullptr), num_of_exchanges(0), abandoned(false)
+{
+	// layout: control block | 2 (parity) * num_of_ranks * 2 (first/last) halo rows | num_of_ranks stripes
+	std::size_t control_size = align_size(sizeof(Shared_Control_Block));
+	std::size_t halo_size = align_size(2 * num_of_ranks * 2 * row_size * sizeof(Cell_State));
+	std::size_t stripes_size = align_size(num_of_ranks * stripe_size * sizeof(Cell_State));
+	mapping_size = control_size + halo_size + stripes_size;
+
+	void* temp = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	// leave transport invalid on failure
+	if(temp == MAP_FAILED)
+		return;
+
+	control = new(temp) Shared_Control_Block{ { 0 }, { 0 }, { false }, Stripe_Command::Calc_Stripe, 0 };
+
+	mapping = temp;
+	halo_slots = reinterpret_cast<Cell_State*>(static_cast<char*>(mapping) + control_size);
+	stripes = reinterpret_cast<Cell_State*>(static_cast<char*>(mapping) + control_size + halo_size);
+}
+
+Shared_Memory_Transport::~Shared_Memory_Transport()
+{
+	if(mapping == nullptr)
+		return;
+
+	munmap(mapping, mapping_size);
+}
+
+std::size_t Shared_Memory_Transport::launch()
+{
+	if(mapping == nullptr)
+		return num_of_ranks;
+
+	const pid_t parent = getpid();
+	for(std::size_t rank = 1; rank < num_of_ranks; ++rank)
+	{
+		pid_t pid = fork();
+
+		// child process: return own rank
+		if(pid == 0)
+		{
+#ifdef __linux__
+			// terminate with rank 0; if it terminated before prctl(), the worker has already another parent
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+			if(getppid() != parent)
+				_exit(1);
+#endif
+			// the other workers are no children of this process
+			workers.clear();
+			return rank;
+		}
+
+		// on failure, terminate already started workers; they are blocked in the barrier
+		if(pid < 0)
+		{
+			for(auto& a : workers)
+			{
+				kill(static_cast<pid_t>(a), SIGKILL);
+				waitpid(static_cast<pid_t>(a), nullptr, 0);
+			}
+			workers.clear();
+
+			return num_of_ranks;
+		}
+
+		workers.push_back(static_cast<long>(pid));
+	}
+
+	return 0;
+}
+
+void Shared_Memory_Transport::join()
+{
+	for(auto& a : workers)
+	{
+		// workers of an abandoned transport may still calculate or wait for a dead rank
+		if(abandoned)
+			kill(static_cast<pid_t>(a), SIGKILL);
+		waitpid(static_cast<pid_t>(a), nullptr, 0);
+	}
+	workers.clear();
+}
+
+bool Shared_Memory_Transport::worker_terminated()
+{
+	for(auto it = workers.begin(); it != workers.end(); ++it)
+		if(waitpid(static_cast<pid_t>(*it), nullptr, WNOHANG) == static_cast<pid_t>(*it))
+		{
+			workers.erase(it);
+			return true;
+		}
+
+	return false;
+}
+
+bool Shared_Memory_Transport::wait_barrier()
+{
+	// the last rank resets the counter before it increases num_of_barriers, so no rank can arrive at the next barrier before
+	const uint32_t barrier = control->num_of_barriers.load(std::memory_order_acquire);
+	if(!control->abandoned.load(std::memory_order_acquire) && control->num_of_waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == num_of_ranks)
+	{
+		control->num_of_waiting.store(0, std::memory_order_relaxed);
+		control->num_of_barriers.fetch_add(1, std::memory_order_release);
+		wake_all(control->num_of_barriers);
+		return true;
+	}
+
+	while(control->num_of_barriers.load(std::memory_order_acquire) == barrier)
+	{
+		// rank 0 abandons the barrier if a worker terminated, so no rank waits for it forever
+		if(!control->abandoned.load(std::memory_order_acquire) && wait_for_change(control->num_of_barriers, barrier) && worker_terminated())
+		{
+			control->abandoned.store(true, std::memory_order_release);
+			wake_all(control->num_of_barriers);
+		}
+
+		if(control->abandoned.load(std::memory_order_acquire))
+		{
+			abandoned = true;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Shared_Memory_Transport::send_command(Stripe_Command command, std::size_t argument)
+{
+	control->command = command;
+	control->argument = argument;
+	// the barrier publishes the command to all ranks
+	return wait_barrier();
+}
+
+Stripe_Command Shared_Memory_Transport::receive_command(std::size_t& argument)
+{
+	if(!wait_barrier())
+		return Stripe_Command::Exit_Stripe;
+
+	argument = control->argument;
+	return control->command;
+}
+
+bool Shared_Memory_Transport::finish_command()
+{
+	return wait_barrier();
+}
+
+bool Shared_Memory_Transport::exchange_halos(std::size_t rank, const Cell_State* first_row, const Cell_State* last_row, Cell_State* upper_halo, Cell_State* lower_halo)
+{
+	std::size_t parity = (num_of_exchanges++) & 0x01;
+
+	// publish own border rows
+	std::memcpy(get_slot(parity, rank, true), first_row, row_size * sizeof(Cell_State));
+	std::memcpy(get_slot(parity, rank, false), last_row, row_size * sizeof(Cell_State));
+
+	// wait until all neighbors have published their rows; the slots of the other parity are written in the next exchange,
+	// which can not start before every rank has passed the next barrier
+	if(!wait_barrier())
+		return false;
+
+	// receive last row of upper neighbor
+	if(rank > 0)
+		std::memcpy(upper_halo, get_slot(parity, rank - 1, false), row_size * sizeof(Cell_State));
+	else if(periodic)
+		std::memcpy(upper_halo, get_slot(parity, num_of_ranks - 1, false), row_size * sizeof(Cell_State));
+
+	// receive first row of lower neighbor
+	if(rank < num_of_ranks - 1)
+		std::memcpy(lower_halo, get_slot(parity, rank + 1, true), row_size * sizeof(Cell_State));
+	else if(periodic)
+		std::memcpy(lower_halo, get_slot(parity, 0, true), row_size * sizeof(Cell_State));
+
+	return true;
+}
+#endif // ENABLE_SHARED_MEMORY_TRANSPORT
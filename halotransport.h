@@ -0,0 +1,112 @@
+// © Copyright (c) 2018 SqYtCO
+
+#ifndef HALOTRANSPORT_H
+#define HALOTRANSPORT_H
+
+#include "basesystem.h"
+#include <cstddef>
+#include <vector>
+
+// commands which are sent from the controlling process (rank 0) to all worker processes
+enum Stripe_Command
+{
+	Calc_Stripe = 0,				// advance the own stripe by the given number of generations (0: only exchange halos and calculate next state)
+	Exit_Stripe						// leave worker loop and terminate process
+};
+
+/* transport interface for domain decomposed systems
+ * each process (rank) owns one stripe of rows; before each calculation the first and last row of every stripe are sent to the neighbor stripes (halo exchange)
+ * rank 0 is the controlling process which sends commands; the ranks 1..N-1 are started by launch() and execute received commands until Exit_Stripe is received
+ * if a rank terminates unexpectedly, the transport is abandoned: all following synchronizing calls return false immediately instead of waiting for it
+ * an implementation has to provide the stripe storage of every rank to rank 0; a message based transport (e.g. MPI) has to gather the stripes on request */
+class Halo_Transport
+{
+public:
+	virtual ~Halo_Transport() = default;
+
+	// start worker processes; return rank of the calling process (0 = controlling process) or a value >= get_num_of_ranks() on failure
+	virtual std::size_t launch() = 0;
+	// wait for termination of all worker processes; only called by rank 0 after Exit_Stripe was sent or after the transport was abandoned (remaining workers are terminated then)
+	virtual void join() = 0;
+
+	// send command and argument to all ranks; only called by rank 0; return false if the transport was abandoned
+	virtual bool send_command(Stripe_Command command, std::size_t argument) = 0;
+	// wait for next command; only called by ranks 1..N-1; return Exit_Stripe if the transport was abandoned
+	virtual Stripe_Command receive_command(std::size_t& argument) = 0;
+	// wait until all ranks have finished the current command; return false if the transport was abandoned
+	virtual bool finish_command() = 0;
+
+	// publish first and last row of the calling rank and receive the neighboring rows; halos beyond the outer stripes are only written if periodic is true
+	// return false if the transport was abandoned; the halos are not received then
+	virtual bool exchange_halos(std::size_t rank, const Cell_State* first_row, const Cell_State* last_row, Cell_State* upper_halo, Cell_State* lower_halo) = 0;
+
+	// return storage of given rank; it contains both states of the stripe including halo rows
+	virtual Cell_State* get_stripe(std::size_t rank) = 0;
+
+	// return number of participating processes including rank 0
+	virtual std::size_t get_num_of_ranks() const = 0;
+};
+
+#if defined(__unix__)
+#define ENABLE_SHARED_MEMORY_TRANSPORT
+#endif
+
+#ifdef ENABLE_SHARED_MEMORY_TRANSPORT
+struct Shared_Control_Block;
+
+/* halo transport for local processes using POSIX shared memory
+ * the worker processes are created by fork(); all stripes, the halo slots and the control block are placed in one shared anonymous mapping
+ * the halo slots are double-buffered, so one barrier per exchange is sufficient
+ * the barrier consists of atomic counters (waits use futexes on Linux); while rank 0 waits, it checks its workers periodically and abandons the barrier if one terminated
+ * the workers are killed if rank 0 terminates (Linux only) */
+class Shared_Memory_Transport : public Halo_Transport
+{
+	std::size_t num_of_ranks;
+	std::size_t row_size;							// cells per row
+	std::size_t stripe_size;						// cells per stripe (both states including halo rows)
+	bool periodic;									// connect first and last stripe
+
+	void* mapping;									// begin of shared mapping
+	std::size_t mapping_size;						// size of shared mapping in bytes
+	Shared_Control_Block* control;					// barrier, command and exchange counter (in mapping)
+	Cell_State* halo_slots;							// published rows of all ranks (in mapping)
+	Cell_State* stripes;							// stripes of all ranks (in mapping)
+
+	std::size_t num_of_exchanges;					// local counter of exchanges; its parity selects the halo slots
+	std::vector<long> workers;						// process ids of running ranks 1..N-1 (only valid in rank 0)
+	bool abandoned;									// true if a barrier of this rank failed
+
+	// wait until all ranks have arrived; return false if the barrier was abandoned
+	bool wait_barrier();
+	// return true if a worker terminated; it is removed from workers (only called by rank 0)
+	bool worker_terminated();
+
+	// return published row of given rank; top selects first row, otherwise last row
+	inline Cell_State* get_slot(std::size_t parity, std::size_t rank, bool top)
+	{
+		return halo_slots + ((parity * num_of_ranks + rank) * 2 + (top ? 0 : 1)) * row_size;
+	}
+
+public:
+	// allocate shared memory for given number of ranks; each stripe contains stripe_size cells
+	Shared_Memory_Transport(std::size_t num_of_ranks, std::size_t row_size, std::size_t stripe_size, bool periodic);
+	virtual ~Shared_Memory_Transport() override;
+
+	virtual std::size_t launch() override;
+	virtual void join() override;
+
+	virtual bool send_command(Stripe_Command command, std::size_t argument) override;
+	virtual Stripe_Command receive_command(std::size_t& argument) override;
+	virtual bool finish_command() override;
+
+	virtual bool exchange_halos(std::size_t rank, const Cell_State* first_row, const Cell_State* last_row, Cell_State* upper_halo, Cell_State* lower_halo) override;
+
+	virtual Cell_State* get_stripe(std::size_t rank) override { return stripes + rank * stripe_size; }
+	virtual std::size_t get_num_of_ranks() const override { return num_of_ranks; }
+
+	// return true if shared memory was allocated successfully
+	inline bool is_valid() const { return mapping != nullptr; }
+};
+#endif // ENABLE_SHARED_MEMORY_TRANSPORT
+
+#endif // HALOTRANSPORT_H
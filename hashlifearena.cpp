@@ -0,0 +1,75 @@
+// © Copyright (c) 2018 SqYtCO
+
+#include "hashlifearena.h"
+#include "hashlifemacrocell.h"
+#include <new>
+
+Macrocell_Arena::Macrocell_Arena(std::size_t num_of_areas) : num_of_slabs(0), areas(num_of_areas, Area{ 0, cells_per_slab, 0, std::vector<uint32_t>() })
+{
+}
+
+Macrocell_Arena::~Macrocell_Arena()
+{
+	clear();
+}
+
+void Macrocell_Arena::add_slab(Area& area)
+{
+	area.slab = num_of_slabs.fetch_add(1);
+	// all indices are assigned
+	if(area.slab >= max_num_of_slabs)
+		throw std::bad_alloc();
+
+	slab_areas[area.slab] = static_cast<uint16_t>(&area - areas.data());
+
+	// uninitialized memory; macrocells are constructed in create()
+	slabs[area.slab] = static_cast<Macrocell*>(::operator new(cells_per_slab * sizeof(Macrocell)));
+	// index 0 represents nullptr, so the first slot of the first slab is never used
+	area.used = (area.slab == 0) ? 1 : 0;
+}
+
+Macrocell_Ref Macrocell_Arena::create(std::size_t area, Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
+{
+	Area& current = areas[area];
+	uint32_t index;
+	if(!current.free_cells.empty())
+	{
+		index = current.free_cells.back();
+		current.free_cells.pop_back();
+	}
+	else
+	{
+		if(current.used == cells_per_slab)
+			add_slab(current);
+
+		index = static_cast<uint32_t>((current.slab << slab_bits) | current.used++);
+	}
+
+	++current.num_of_cells;
+	new(get(index)) Macrocell(nw, ne, se, sw);
+	return Macrocell_Ref(index);
+}
+
+void Macrocell_Arena::clear()
+{
+	// macrocells are trivially destructible; release memory only
+	for(std::size_t i = 0; i < num_of_slabs; ++i)
+		::operator delete(slabs[i]);
+
+	num_of_slabs = 0;
+	for(auto& a : areas)
+		a = Area{ 0, cells_per_slab, 0, std::vector<uint32_t>() };
+}
+
+std::size_t Macrocell_Arena::get_memory_usage() const
+{
+	return num_of_slabs * cells_per_slab * sizeof(Macrocell);
+}
+
+std::size_t Macrocell_Arena::get_num_of_cells() const
+{
+	std::size_t sum = 0;
+	for(const auto& a : areas)
+		sum += a.num_of_cells;
+	return sum;
+}
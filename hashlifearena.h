@@ -0,0 +1,98 @@
+// © Copyright (c) 2018 SqYtCO
+
+#ifndef HASHLIFEARENA_H
+#define HASHLIFEARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Macrocell;
+
+// handle of a macrocell; it stores the 32-bit index of the macrocell in Macrocell_Arena instead of a pointer, so a macrocell needs only 24 bytes
+// index 0 is never assigned and represents nullptr; the macrocell is accessed by -> like a pointer
+class Macrocell_Ref
+{
+	uint32_t index;
+
+public:
+	inline Macrocell_Ref() : index(0) {	}
+	inline Macrocell_Ref(std::nullptr_t) : index(0) {	}
+	inline explicit Macrocell_Ref(uint32_t index) : index(index) {	}
+
+	// return referenced macrocell; defined in hashlifemacrocell.h
+	inline Macrocell* get() const;
+	inline Macrocell* operator->() const;
+	inline Macrocell& operator*() const;
+
+	inline explicit operator bool() const { return index != 0; }
+	inline bool operator==(Macrocell_Ref other) const { return index == other.index; }
+	inline bool operator!=(Macrocell_Ref other) const { return index != other.index; }
+	inline bool operator==(std::nullptr_t) const { return index == 0; }
+	inline bool operator!=(std::nullptr_t) const { return index != 0; }
+
+	inline uint32_t get_index() const { return index; }
+};
+
+/* allocator for macrocells
+ * macrocells are carved from large contiguous slabs by increasing an index (bump allocation); cells created one after another are adjacent in memory
+ * the index of a macrocell selects its slab (upper bits) and its position in the slab (lower 16 bits); so up to 2^32 - 1 macrocells can be addressed
+ * the arena is divided into areas; each area fills its own slab and has its own free list, so different areas can be used by different threads at the same time
+ * released cells (garbage collection) are kept in the free list of the area which owns their slab and reused by create(); clear() releases all slabs at once */
+class Macrocell_Arena
+{
+	// num of macrocells per slab (power of two)
+	static constexpr std::size_t slab_bits = 16;
+	static constexpr std::size_t cells_per_slab = 1 << slab_bits;
+	static constexpr std::size_t max_num_of_slabs = 1 << (32 - slab_bits);
+
+	// begin of all allocated slabs; a fixed array avoids an additional indirection when resolving an index
+	Macrocell* slabs[max_num_of_slabs];
+	// area which fills the slab; released cells are returned to it
+	uint16_t slab_areas[max_num_of_slabs];
+	std::atomic<std::size_t> num_of_slabs;
+
+	struct Area
+	{
+		std::size_t slab;						// slab which is currently filled
+		std::size_t used;						// num of used macrocells in slab
+		std::size_t num_of_cells;				// num of created macrocells which are not released
+		std::vector<uint32_t> free_cells;		// indices of released macrocells which are reused before the slab is extended
+	};
+	std::vector<Area> areas;
+
+	// allocate new slab for given area
+	void add_slab(Area& area);
+
+public:
+	// create arena with given num of areas
+	Macrocell_Arena(std::size_t num_of_areas = 1);
+	// release all slabs
+	~Macrocell_Arena();
+
+	Macrocell_Arena(const Macrocell_Arena&) = delete;
+	Macrocell_Arena& operator=(const Macrocell_Arena&) = delete;
+
+	// construct macrocell with given daughter cells in next free slot of given area and return its handle
+	Macrocell_Ref create(std::size_t area, Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw);
+	// return given macrocell to the free list of the area which owns its slab; it has to be removed from the hash table before
+	inline void release(Macrocell_Ref cell)
+	{
+		Area& owner = areas[slab_areas[cell.get_index() >> slab_bits]];
+		owner.free_cells.emplace_back(cell.get_index());
+		--owner.num_of_cells;
+	}
+	// release all macrocells; all handles returned by create() become invalid
+	void clear();
+
+	// return macrocell of given index; defined in hashlifemacrocell.h
+	inline Macrocell* get(uint32_t index) const;
+
+	// return num of bytes allocated by all slabs
+	std::size_t get_memory_usage() const;
+	// return num of created macrocells which are not released
+	std::size_t get_num_of_cells() const;
+};
+
+#endif // HASHLIFEARENA_H
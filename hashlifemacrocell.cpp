@@ -1,33 +1,154 @@
 // © Copyright (c) 2018 SqYtCO
 
 #include "hashlifemacrocell.h"
+#include "hashlifestore.h"
 #include "hashlifetable.h"
+#include "taskpool.h"
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 
 // definition of static members
 HashLife_Table Macrocell::hash_table;
+HashLife_Store* Macrocell::store = nullptr;
+bool Macrocell::symmetric = false;
 
-Macrocell* Macrocell::new_macrocell(Macrocell* nw, Macrocell* ne, Macrocell* se, Macrocell* sw)
+Macrocell_Ref Macrocell::new_macrocell(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
 {
-	Macrocell* temp = Macrocell::hash_table.get(nw, ne, se, sw);
 	// if cell was found in hash_table, return it; otherwise insert a new macrocell and return it
-	if(temp)
-		return temp;
-	else
+	return Macrocell::hash_table.find_or_create(nw, ne, se, sw);
+}
+
+Macrocell_Ref Macrocell::leaf_center(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
+{
+	constexpr uint64_t low_nibbles = 0x0F0F0F0Full;
+	// rows 4-7 of northern leaves and rows 0-3 of southern leaves; columns 4-7 of western leaves and columns 0-3 of eastern leaves
+	uint64_t north = ((nw->get_bits() >> 36) & low_nibbles) | (((ne->get_bits() >> 32) & low_nibbles) << 4);
+	uint64_t south = ((sw->get_bits() >> 4) & low_nibbles) | ((se->get_bits() & low_nibbles) << 4);
+
+	return new_leaf(north | (south << 32));
+}
+
+Macrocell_Ref Macrocell::build(std::vector<uint64_t>& cells, std::size_t level)
+{
+	std::sort(cells.begin(), cells.end());
+	cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+	hash_table.set_level(level);
+
+	// open cells of the levels leaf_level + 1 to level (index level - leaf_level - 1): their daughter cells and the morton code of their position (none if there is no open cell)
+	// a cell is closed (created) when the first leaf outside of it is reached; the codes are sorted, so it gets no more living cells
+	constexpr uint64_t none = ~0ull;
+	// index of daughter cell (nw, ne, se, sw) of the two lowest bits of a morton code
+	constexpr std::size_t daughter_of_code[4] = { 0, 1, 3, 2 };
+	const std::size_t num_of_levels = level - leaf_level;
+	std::vector<std::array<Macrocell_Ref, 4>> daughters(num_of_levels);
+	std::vector<uint64_t> codes(num_of_levels, none);
+	for(std::size_t i = 0; i < num_of_levels; ++i)
+		daughters[i].fill(hash_table.get_empty(leaf_level + i));
+	Macrocell_Ref root = hash_table.get_empty(level);
+
+	// close the open cells of the lowest given num of levels; each cell becomes a daughter cell of the open cell above
+	auto close = [&] (std::size_t num)
 	{
-		temp = new Macrocell(nw, ne, se, sw);
-		Macrocell::hash_table.insert(temp, temp);
-		return temp;
+		for(std::size_t i = 0; i < num; ++i)
+		{
+			Macrocell_Ref cell = new_macrocell(daughters[i][0], daughters[i][1], daughters[i][2], daughters[i][3]);
+			if(i + 1 < num_of_levels)
+				daughters[i + 1][daughter_of_code[codes[i] & 0x03]] = cell;
+			else
+				root = cell;
+
+			daughters[i].fill(hash_table.get_empty(leaf_level + i));
+			codes[i] = none;
+		}
+	};
+
+	for(auto a = cells.begin(); a != cells.end(); )
+	{
+		// collect the living cells of one leaf
+		const uint64_t leaf_code = *a >> (2 * leaf_level);
+		uint64_t bits = 0;
+		for(; a != cells.end() && (*a >> (2 * leaf_level)) == leaf_code; ++a)
+		{
+			const uint64_t code = *a;
+			const uint64_t x = (code & 0x01) | ((code >> 1) & 0x02) | ((code >> 2) & 0x04);
+			const uint64_t y = ((code >> 1) & 0x01) | ((code >> 2) & 0x02) | ((code >> 3) & 0x04);
+			bits |= 0x01ull << (y * 8 + x);
+		}
+
+		// open cells which do not contain the leaf are closed; if a cell contains it, all larger cells contain it too
+		std::size_t num = 0;
+		while(num < num_of_levels && codes[num] != none && codes[num] != leaf_code >> (2 * (num + 1)))
+			++num;
+		close(num);
+
+		for(std::size_t i = 0; i < num_of_levels; ++i)
+			codes[i] = leaf_code >> (2 * (i + 1));
+		daughters[0][daughter_of_code[leaf_code & 0x03]] = new_leaf(bits);
 	}
+
+	if(!cells.empty())
+		close(num_of_levels);
+
+	return root;
 }
 
-Macrocell::Macrocell(Macrocell* nw, Macrocell* ne, Macrocell* se, Macrocell* sw)
-	: nw(nw), ne(ne), se(se), sw(sw), result(nullptr)
+Macrocell::Macrocell(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
+	: nw(nw), ne(ne), se(se), sw(sw)
 {
-	// check if cell is a zero level cell and set population
-	if(ne == nullptr)
-		this->population = (nw != nullptr);
+	// check if cell is a leaf and set population
+	uint64_t population;
+	if(se == nullptr)
+		population = std::bitset<64>(get_bits()).count();
 	else
-		this->population = nw->population + ne->population + se->population + sw->population;
+	{
+		// sum up in 64 bit and saturate
+		population = static_cast<uint64_t>(nw->get_saturated_population()) + ne->get_saturated_population() + se->get_saturated_population() + sw->get_saturated_population();
+		if(population > saturated_population)
+			population = saturated_population;
+	}
+
+	info.store(population << population_shift, std::memory_order_relaxed);
+}
+
+// sum up populations of saturated macrocells; already summed up macrocells are stored in known
+template<typename Integer>
+static Integer exact_population(const Macrocell* cell, std::unordered_map<const Macrocell*, Integer>& known)
+{
+	if(cell->get_saturated_population() != Macrocell::saturated_population)
+		return cell->get_saturated_population();
+
+	auto found = known.find(cell);
+	if(found != known.end())
+		return found->second;
+
+	Integer sum = exact_population(cell->nw.get(), known);
+	sum += exact_population(cell->ne.get(), known);
+	sum += exact_population(cell->se.get(), known);
+	sum += exact_population(cell->sw.get(), known);
+	known.emplace(cell, sum);
+	return sum;
+}
+
+std::size_t Macrocell::get_population() const
+{
+	if(get_saturated_population() != saturated_population)
+		return get_saturated_population();
+
+	std::unordered_map<const Macrocell*, std::size_t> known;
+	return exact_population(this, known);
+}
+
+Big_Integer Macrocell::get_big_population() const
+{
+	if(get_saturated_population() != saturated_population)
+		return get_saturated_population();
+
+	std::unordered_map<const Macrocell*, Big_Integer> known;
+	return exact_population(this, known);
 }
 
 std::size_t Macrocell::hash() const
@@ -35,77 +156,434 @@ std::size_t Macrocell::hash() const
 	return HashLife_Table::hash(nw, ne, se, sw);
 }
 
-Macrocell* Macrocell::set_state(std::size_t x, std::size_t y, std::size_t level, Cell_State state)
+Macrocell_Ref Macrocell::set_state(std::size_t x, std::size_t y, std::size_t level, Cell_State state)
 {
-	if(ne == nullptr)
-		return (state) ? hash_table.get_alive() : hash_table.get_dead();
-	if(!state && population == 0)
-		return this;
+	// an empty cell stays the empty cell of its level
+	if(!state && is_empty())
+		return hash_table.get_empty(level);
+	if(is_leaf())
+	{
+		uint64_t bit = 0x01ull << (y * 8 + x);
+		return new_leaf((state) ? (get_bits() | bit) : (get_bits() & ~bit));
+	}
 
-	Macrocell* cell = new Macrocell(nw, ne, se, sw);
+	Macrocell_Ref nw_ = nw;
+	Macrocell_Ref ne_ = ne;
+	Macrocell_Ref se_ = se;
+	Macrocell_Ref sw_ = sw;
 	std::size_t size = 0x01ull << (--level);
 
 	if(x < size)
 	{
 		if(y < size)
-			cell->nw = nw->set_state(x, y, level, state);
+			nw_ = nw->set_state(x, y, level, state);
 		else
-			cell->sw = sw->set_state(x, y - size, level, state);
+			sw_ = sw->set_state(x, y - size, level, state);
 	}
 	else
 	{
 		if(y < size)
-			cell->ne = ne->set_state(x - size, y, level, state);
+			ne_ = ne->set_state(x - size, y, level, state);
 		else
-			cell->se = se->set_state(x - size, y - size, level, state);
+			se_ = se->set_state(x - size, y - size, level, state);
 	}
 
-	Macrocell* temp = hash_table[cell];
-	if(temp)
+	// look up changed cell by its daughter cells; a new cell is only created if it does not exist yet
+	return new_macrocell(nw_, ne_, se_, sw_);
+}
+
+void Macrocell::set_result(Macrocell_Ref cell, std::size_t exp, Macrocell_Ref result)
+{
+	uint64_t value = cell->info.load(std::memory_order_relaxed);
+	cell->info.store((value & (static_cast<uint64_t>(saturated_population) << population_shift)) | (static_cast<uint64_t>(exp + 1) << 32) | result.get_index(),
+					 std::memory_order_release);
+
+	// keep result of previous exponent, so switching back does not recalculate it
+	std::size_t previous_exp = (value >> 32) & 0xFF;
+	if(previous_exp != 0 && previous_exp != exp + 1)
+		hash_table.cache_result(cell, previous_exp - 1, Macrocell_Ref(static_cast<uint32_t>(value)));
+}
+
+// return cells of leaf after given transformation (see Macrocell::transform()); bit y * 8 + x is the cell at x,y
+static uint64_t transform_bits(uint64_t bits, std::size_t transformation)
+{
+	// transpose 8x8 cells by swapping the off-diagonal 1x1, 2x2 and 4x4 blocks
+	if(transformation & 0x04)
 	{
-		delete cell;
-		return temp;
+		uint64_t temp = (bits ^ (bits >> 7)) & 0x00AA00AA00AA00AAull;
+		bits ^= temp ^ (temp << 7);
+		temp = (bits ^ (bits >> 14)) & 0x0000CCCC0000CCCCull;
+		bits ^= temp ^ (temp << 14);
+		temp = (bits ^ (bits >> 28)) & 0x00000000F0F0F0F0ull;
+		bits ^= temp ^ (temp << 28);
+	}
+	// reverse bits of each row
+	if(transformation & 0x01)
+	{
+		bits = ((bits >> 1) & 0x5555555555555555ull) | ((bits & 0x5555555555555555ull) << 1);
+		bits = ((bits >> 2) & 0x3333333333333333ull) | ((bits & 0x3333333333333333ull) << 2);
+		bits = ((bits >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((bits & 0x0F0F0F0F0F0F0F0Full) << 4);
+	}
+	// reverse order of rows
+	if(transformation & 0x02)
+	{
+		bits = ((bits >> 8) & 0x00FF00FF00FF00FFull) | ((bits & 0x00FF00FF00FF00FFull) << 8);
+		bits = ((bits >> 16) & 0x0000FFFF0000FFFFull) | ((bits & 0x0000FFFF0000FFFFull) << 16);
+		bits = (bits >> 32) | (bits << 32);
+	}
+
+	return bits;
+}
+
+Macrocell_Ref Macrocell::transform(Macrocell_Ref cell, std::size_t transformation, bool create)
+{
+	// empty cells are their own image
+	if(transformation == 0 || cell->is_empty())
+		return cell;
+
+	if(cell->is_leaf())
+	{
+		const uint64_t bits = transform_bits(cell->get_bits(), transformation);
+		if(create)
+			return new_leaf(bits);
+		return hash_table.get(Macrocell_Ref(static_cast<uint32_t>(bits)), Macrocell_Ref(static_cast<uint32_t>(bits >> 32)), nullptr, nullptr);
+	}
+
+	Macrocell_Ref image = hash_table.get_cached_result(cell, image_exp + transformation);
+	if(image)
+		return image;
+	// a missing image is only looked up again if it is created
+	if(!create && hash_table.get_cached_result(cell, missing_image_exp + transformation) == cell)
+		return nullptr;
+
+	// the daughter cell at quadrant x,y is the image of the daughter cell at the transformed quadrant
+	const Macrocell_Ref quadrants[4] = { cell->nw, cell->ne, cell->sw, cell->se };
+	Macrocell_Ref images[4];
+	for(std::size_t i = 0; i < 4; ++i)
+	{
+		std::size_t x = i & 0x01, y = i >> 1;
+		if(transformation & 0x04)
+			std::swap(x, y);
+		x ^= transformation & 0x01;
+		y ^= (transformation >> 1) & 0x01;
+
+		images[y * 2 + x] = transform(quadrants[i], transformation, create);
+		// if a daughter image does not exist, the image does not exist either
+		if(!images[y * 2 + x])
+			break;
+	}
+
+	if(images[0] && images[1] && images[2] && images[3])
+		image = (create) ? new_macrocell(images[0], images[1], images[3], images[2]) : hash_table.get(images[0], images[1], images[3], images[2]);
+	if(image)
+	{
+		hash_table.cache_result(cell, image_exp + transformation, image);
+		hash_table.cache_result(image, image_exp + inverse(transformation), cell);
 	}
 	else
+		hash_table.cache_result(cell, missing_image_exp + transformation, cell);
+
+	return image;
+}
+
+// return result of 2^exp generations of an existing image of given cell (transformed back); return nullptr if no image has a result
+static Macrocell_Ref get_image_result(Macrocell_Ref cell, std::size_t exp)
+{
+	// images were already looked up without result
+	if(Macrocell::hash_table.get_cached_result(cell, Macrocell::no_image_exp + exp) == cell)
+		return nullptr;
+
+	for(std::size_t transformation = 1; transformation < 8; ++transformation)
 	{
-		if(state)
-			cell->population = population + 1;
-		else
-			cell->population = population - 1;
+		Macrocell_Ref image = Macrocell::transform(cell, transformation, false);
+		// symmetric cells are their own image
+		if(!image || image == cell)
+			continue;
+
+		Macrocell_Ref result = image->get_result(exp);
+		if(!result)
+			result = Macrocell::hash_table.get_cached_result(image, exp);
+		// the center of a cell is the center of its image, so the result is the image of the result
+		if(result)
+			return Macrocell::transform(result, Macrocell::inverse(transformation), true);
+	}
+
+	// the cell is calculated itself afterwards; results of images which are calculated later are not looked up again
+	Macrocell::hash_table.cache_result(cell, Macrocell::no_image_exp + exp, cell);
+	return nullptr;
+}
+
+// return result of 2^min(generations, level - 2) generations of given cell if it is known or calculated without its daughter results (empty cells and 16x16 cells); otherwise return nullptr
+static Macrocell_Ref resolve(Macrocell_Ref cell, std::size_t level, std::size_t generations)
+{
+	// a cell can advance at most 2^(level - 2) generations; larger exponents have the same result, which is stored as full_speed
+	const std::size_t exp = (generations >= level - 2) ? Macrocell::full_speed : generations;
+	Macrocell_Ref known = cell->get_result(exp);
+	// result may be replaced by the result of another exponent
+	if(!known && !cell->is_empty())
+		known = Macrocell::hash_table.get_cached_result(cell, exp);
+	// result of a mirrored or rotated image of the cell may be known
+	if(!known && Macrocell::symmetric && level >= Macrocell::symmetry_level && !cell->is_empty())
+	{
+		known = get_image_result(cell, exp);
+		if(known)
+			Macrocell::set_result(cell, exp, known);
+	}
+	// result of a large cell may be stored by a previous session
+	if(!known && Macrocell::store && level >= HashLife_Store::min_level && !cell->is_empty())
+	{
+		known = Macrocell::store->get_result(cell, level, exp);
+		if(known)
+			Macrocell::set_result(cell, exp, known);
+	}
+	// empty cells are never calculated, so they count as hits
+	Macrocell::hash_table.count_result(known || cell->is_empty());
+	if(known)
+		return known;
+	if(cell->is_empty())
+		return Macrocell::hash_table.get_empty(level - 1);
+
+	// 16x16 cells: calculate up to 4 generations directly
+	if(level == Macrocell::leaf_level + 1)
+	{
+		known = Macrocell::hash_table.calculate_leaves(cell->nw, cell->ne, cell->se, cell->sw, 0x01ull << std::min(generations, level - 2));
+		Macrocell::set_result(cell, exp, known);
+	}
+
+	return known;
+}
+
+// cell of Macrocell::calculate() whose daughter results are calculated; the results of its first step daughters are calculated by the following frames of the stack
+struct Calculation_Frame
+{
+	Macrocell_Ref cell;
+	std::size_t level;
+	// results of the nine overlapping daughter cells (nw, nn, ne, ww, center, ee, sw, ss, se) and of the four quarters of the second step
+	// step is the num of results which are calculated; the quarters are built after the ninth result if the cell advances in two steps
+	Macrocell_Ref parts[9];
+	Macrocell_Ref quarters[4];
+	std::size_t step;
+	// share of the progress of the whole calculation; 0 if the frame is too small to count
+	uint64_t weight;
+
+	Calculation_Frame(Macrocell_Ref cell, std::size_t level, uint64_t weight) : cell(cell), level(level), step(0), weight(weight)
+	{
+		const Macrocell_Ref nw = cell->nw, ne = cell->ne, se = cell->se, sw = cell->sw;
+		// the five overlapping daughter cells (nn, ww, center, ee, ss; see Macrocell::nn() etc.) are looked up together
+		const Macrocell_Ref daughters[5][4] = { { nw->ne, ne->nw, ne->sw, nw->se }, { nw->sw, nw->se, sw->ne, sw->nw }, { nw->se, ne->sw, se->nw, sw->ne },
+												{ ne->sw, ne->se, se->ne, se->nw }, { sw->ne, se->nw, se->sw, sw->se } };
+		Macrocell_Ref cells[5];
+		Macrocell::new_macrocells(5, daughters, cells);
+
+		parts[0] = nw;
+		parts[1] = cells[0];
+		parts[2] = ne;
+		parts[3] = cells[1];
+		parts[4] = cells[2];
+		parts[5] = cells[3];
+		parts[6] = sw;
+		parts[7] = cells[4];
+		parts[8] = se;
+	}
 
-		hash_table.insert(cell, cell);
+	inline Macrocell_Ref& next_result() { return (step < 9) ? parts[step] : quarters[step - 9]; }
+	// count the current result and build the quarters of the second step if it was the last result of the first step
+	void next_step(bool two_steps)
+	{
+		if(++step == 9 && two_steps)
+		{
+			const Macrocell_Ref daughters[4][4] = { { parts[0], parts[1], parts[4], parts[3] }, { parts[1], parts[2], parts[5], parts[4] },
+													{ parts[4], parts[5], parts[8], parts[7] }, { parts[3], parts[4], parts[7], parts[6] } };
+			Macrocell::new_macrocells(4, daughters, quarters);
+		}
 	}
+};
+
+// each of the (up to) 13 daughter results of a frame counts 1/13 of its weight; frames below min_weight are counted as a whole
+static constexpr std::size_t results_per_frame = 13;
+static constexpr uint64_t min_weight = Calculation_Control::total >> 24;
 
-	return cell;
+static inline void add_progress(Calculation_Control* control, uint64_t weight)
+{
+	if(control && weight)
+		control->done.fetch_add(weight, std::memory_order_relaxed);
 }
 
-Macrocell* Macrocell::calculate(std::size_t level, std::size_t generations)
+// calculate result of given cell with an explicit stack of frames instead of recursion; return nullptr if the calculation was cancelled by control
+// cells of at least parallel_level calculate their daughter results as tasks of pool; each task evaluates its daughter cell with an own stack
+static Macrocell_Ref evaluate(Macrocell_Ref cell, std::size_t level, std::size_t generations, Task_Pool* pool, Calculation_Control* control, uint64_t weight)
 {
+	Macrocell_Ref result = resolve(cell, level, generations);
 	if(result)
-		return result;
-	if(population == 0)
 	{
-		result = Macrocell::hash_table.get_empty(level - 1);
+		add_progress(control, weight);
 		return result;
 	}
 
-	std::size_t half = level - 3;
-	Macrocell* nw_ = nw->calculate(level - 1, generations);
-	Macrocell* nn_ = nn()->calculate(level - 1, generations);
-	Macrocell* ne_ = ne->calculate(level - 1, generations);
-	Macrocell* ww_ = ww()->calculate(level - 1, generations);
-	Macrocell* cc_ = center()->calculate(level - 1, generations);
-	Macrocell* ee_ = ee()->calculate(level - 1, generations);
-	Macrocell* sw_ = sw->calculate(level - 1, generations);
-	Macrocell* ss_ = ss()->calculate(level - 1, generations);
-	Macrocell* se_ = se->calculate(level - 1, generations);
+	std::vector<Calculation_Frame> stack;
+	stack.reserve(level);
+	stack.emplace_back(cell, level, weight);
+	while(true)
+	{
+		if(control && control->cancel.load(std::memory_order_relaxed))
+			return nullptr;
+
+		Calculation_Frame& frame = stack.back();
+		const std::size_t half = frame.level - 3;
+		const bool two_steps = generations > half;
+		const std::size_t num_of_steps = (two_steps) ? 13 : 9;
+		const uint64_t daughter_weight = frame.weight / results_per_frame;
+
+		// all daughter results are known: combine them to the result of the frame
+		if(frame.step == num_of_steps)
+		{
+			Macrocell_Ref nw_, ne_, se_, sw_;
+			if(two_steps)
+			{
+				nw_ = frame.quarters[0];
+				ne_ = frame.quarters[1];
+				se_ = frame.quarters[2];
+				sw_ = frame.quarters[3];
+			}
+			else
+			{
+				const Macrocell_Ref* parts = frame.parts;
+				if(frame.level == Macrocell::leaf_level + 2)
+				{
+					// intermediate results are leaves; combine their inner quarters
+					nw_ = Macrocell::leaf_center(parts[0], parts[1], parts[4], parts[3]);
+					ne_ = Macrocell::leaf_center(parts[1], parts[2], parts[5], parts[4]);
+					se_ = Macrocell::leaf_center(parts[4], parts[5], parts[8], parts[7]);
+					sw_ = Macrocell::leaf_center(parts[3], parts[4], parts[7], parts[6]);
+				}
+				else
+				{
+					const Macrocell_Ref daughters[4][4] = { { parts[0]->se, parts[1]->sw, parts[4]->nw, parts[3]->ne }, { parts[1]->se, parts[2]->sw, parts[5]->nw, parts[4]->ne },
+															{ parts[4]->se, parts[5]->sw, parts[8]->nw, parts[7]->ne }, { parts[3]->se, parts[4]->sw, parts[7]->nw, parts[6]->ne } };
+					Macrocell_Ref results[4];
+					Macrocell::new_macrocells(4, daughters, results);
+					nw_ = results[0];
+					ne_ = results[1];
+					se_ = results[2];
+					sw_ = results[3];
+				}
+				// the combination counts as the four results of the second step
+				add_progress(control, daughter_weight * 4);
+			}
+
+			result = Macrocell::new_macrocell(nw_, ne_, se_, sw_);
+			const std::size_t exp = (generations >= frame.level - 2) ? Macrocell::full_speed : generations;
+			Macrocell::set_result(frame.cell, exp, result);
+			if(Macrocell::store && frame.level >= HashLife_Store::min_level)
+				Macrocell::store->set_result(frame.cell, frame.level, exp, result);
 
-	if(generations > half)
+			const uint64_t frame_weight = frame.weight;
+			stack.pop_back();
+			if(stack.empty())
+				return result;
+
+			// a frame which was too small to count is counted by its parent
+			Calculation_Frame& parent = stack.back();
+			parent.next_result() = result;
+			parent.next_step(generations > parent.level - 3);
+			if(!frame_weight)
+				add_progress(control, parent.weight / results_per_frame);
+			continue;
+		}
+
+		// large cells: calculate the daughter results of each step in parallel
+		if(pool && frame.level >= Macrocell::parallel_level)
+		{
+			Macrocell_Ref* results = (frame.step < 9) ? frame.parts : frame.quarters;
+			const std::size_t num = (frame.step < 9) ? 9 : 4;
+			std::function<void(std::size_t)> calc_result = [results, &frame, generations, pool, control, daughter_weight] (std::size_t i)
+			{
+				results[i] = evaluate(results[i], frame.level - 1, generations, pool, control, daughter_weight);
+			};
+			pool->run(num, calc_result);
+			for(std::size_t i = 0; i < num; ++i)
+				if(!results[i])
+					return nullptr;
+
+			frame.step += num - 1;
+			frame.next_step(two_steps);
+			continue;
+		}
+
+		// known daughter results are taken at once; the other ones get an own frame
+		Macrocell_Ref& next = frame.next_result();
+		Macrocell_Ref known = resolve(next, frame.level - 1, generations);
+		if(known)
+		{
+			next = known;
+			frame.next_step(two_steps);
+			add_progress(control, daughter_weight);
+		}
+		else
+		{
+			// copy before the stack grows
+			const Macrocell_Ref daughter = next;
+			const std::size_t daughter_level = frame.level - 1;
+			stack.emplace_back(daughter, daughter_level, (daughter_weight >= min_weight) ? daughter_weight : 0);
+		}
+	}
+}
+
+Macrocell_Ref Macrocell::calculate(Macrocell_Ref cell, std::size_t level, std::size_t generations, Task_Pool* pool, Calculation_Control* control)
+{
+	Macrocell_Ref result = evaluate(cell, level, generations, pool, control, (control) ? Calculation_Control::total : 0);
+	// the results of the threads are copied into the store after the calculation (also if it was cancelled)
+	if(store)
+		store->merge_results();
+	return result;
+}
+
+Macrocell_Ref Macrocell::calculate_region(Macrocell_Ref cell, std::size_t level, std::size_t generations,
+										  std::size_t x_begin, std::size_t y_begin, std::size_t x_end, std::size_t y_end, Task_Pool* pool)
+{
+	// the result is the center of cell
+	const std::size_t quarter = 0x01ull << (level - 2);
+	x_begin = std::max(x_begin, quarter);
+	y_begin = std::max(y_begin, quarter);
+	x_end = std::min(x_end, 3 * quarter);
+	y_end = std::min(y_end, 3 * quarter);
+	if(x_begin >= x_end || y_begin >= y_end || cell->is_empty())
+		return hash_table.get_empty(level - 1);
+
+	// calculate whole result if the rectangle covers it or the cell is small
+	if((x_begin == quarter && y_begin == quarter && x_end == 3 * quarter && y_end == 3 * quarter) || level <= leaf_level + 2)
+		return calculate(cell, level, generations, pool);
+
+	// calculate given rectangle (positions in cell) of the daughter cell at given origin
+	auto calc_part = [level, generations, pool] (Macrocell_Ref part, std::size_t x, std::size_t y, std::size_t x_begin, std::size_t y_begin, std::size_t x_end, std::size_t y_end)
 	{
-		nw_ = Macrocell::new_macrocell(nw_, nn_, cc_, ww_)->calculate(level - 1, generations);
-		ne_ = Macrocell::new_macrocell(nn_, ne_, ee_, cc_)->calculate(level - 1, generations);
-		se_ = Macrocell::new_macrocell(cc_, ee_, se_, ss_)->calculate(level - 1, generations);
-		sw_ = Macrocell::new_macrocell(ww_, cc_, ss_, sw_)->calculate(level - 1, generations);
+		return calculate_region(part, level - 1, generations, (x_begin > x) ? x_begin - x : 0, (y_begin > y) ? y_begin - y : 0,
+								(x_end > x) ? x_end - x : 0, (y_end > y) ? y_end - y : 0, pool);
+	};
+
+	// if the result is calculated in two steps, the first step has to calculate the rectangle and its neighbors which are reached by the second step
+	const bool two_steps = generations > level - 3;
+	const std::size_t margin = (two_steps) ? quarter / 2 : 0;
+
+	// results of the nine overlapping daughter cells: nw, nn, ne, ww, center, ee, sw, ss, se; daughter cell x,y starts at x * quarter,y * quarter
+	Macrocell_Ref parts[9] = { cell->nw, cell->nn(), cell->ne, cell->ww(), cell->center(), cell->ee(), cell->sw, cell->ss(), cell->se };
+	for(std::size_t i = 0; i < 9; ++i)
+		parts[i] = calc_part(parts[i], (i % 3) * quarter, (i / 3) * quarter, x_begin - margin, y_begin - margin, x_end + margin, y_end + margin);
+
+	Macrocell_Ref nw_ = parts[0], nn_ = parts[1], ne_ = parts[2];
+	Macrocell_Ref ww_ = parts[3], cc_ = parts[4], ee_ = parts[5];
+	Macrocell_Ref sw_ = parts[6], ss_ = parts[7], se_ = parts[8];
+
+	if(two_steps)
+	{
+		// quarter x,y starts at (2 * x + 1) * quarter / 2,(2 * y + 1) * quarter / 2
+		const std::size_t offset = quarter / 2;
+		Macrocell_Ref quarters[4] = { Macrocell::new_macrocell(nw_, nn_, cc_, ww_), Macrocell::new_macrocell(nn_, ne_, ee_, cc_),
+									  Macrocell::new_macrocell(cc_, ee_, se_, ss_), Macrocell::new_macrocell(ww_, cc_, ss_, sw_) };
+		nw_ = calc_part(quarters[0], offset, offset, x_begin, y_begin, x_end, y_end);
+		ne_ = calc_part(quarters[1], quarter + offset, offset, x_begin, y_begin, x_end, y_end);
+		se_ = calc_part(quarters[2], quarter + offset, quarter + offset, x_begin, y_begin, x_end, y_end);
+		sw_ = calc_part(quarters[3], offset, quarter + offset, x_begin, y_begin, x_end, y_end);
 	}
 	else
 	{
@@ -115,6 +593,5 @@ Macrocell* Macrocell::calculate(std::size_t level, std::size_t generations)
 		sw_ = Macrocell::new_macrocell(ww_->se, cc_->sw, ss_->nw, sw_->ne);
 	}
 
-	result = Macrocell::new_macrocell(nw_, ne_, se_, sw_);
-	return result;
+	return Macrocell::new_macrocell(nw_, ne_, se_, sw_);
 }
@@ -4,57 +4,162 @@
 #define HASHLIFEMACROCELL_H
 
 #include "basesystem.h"
+#include "biginteger.h"
+#include "hashlifetable.h"
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <vector>
 
-class HashLife_Table;
+class HashLife_Store;
+class Task_Pool;
+
+// lets other threads cancel a calculation of Macrocell::calculate() and read its progress
+struct Calculation_Control
+{
+	// progress of a whole calculation
+	static constexpr uint64_t total = 0x01ull << 60;
+
+	// if set, the calculation returns nullptr as soon as possible; results which were completed are kept
+	std::atomic<bool> cancel;
+	// completed part of total; it is only raised (results of large daughter cells are counted in 1/13 of their cell, smaller ones as a whole)
+	std::atomic<uint64_t> done;
+
+	Calculation_Control() : cancel(false), done(0) {	}
+};
 
 // class for recursive hashlife algorithm
+// daughter cells are 32-bit values and result and population share one 64-bit word (24 bytes per macrocell); daughter cells and result are referenced by their index in the arena of hash_table
+// the smallest macrocells are leaves of 8x8 cells (level 3); their cells are stored as bitboard in nw (lower 32 bit) and ne (upper 32 bit), se and sw are nullptr
 struct Macrocell
 {
 	static HashLife_Table hash_table;
+	// results of large cells are looked up in the store and added to it if it is set (see HashLife_System::open_store()); nullptr disables it
+	static HashLife_Store* store;
+	// if true, results of mirrored and rotated images of a cell (D4 symmetry) are reused; the rules depend only on the num of neighbors, so they are always isotropic
+	static bool symmetric;
 
-	// num of living zero level cells in macrocell
-	std::size_t population;
+	// level of leaves; a leaf contains 2^leaf_level x 2^leaf_level cells
+	static constexpr std::size_t leaf_level = 3;
+	// smallest level whose daughter results are calculated in parallel (if a task pool is given)
+	static constexpr std::size_t parallel_level = leaf_level + 7;
 
 	// smaller daughter cells with level n-1
-	Macrocell* nw;
-	Macrocell* ne;
-	Macrocell* se;
-	Macrocell* sw;
-	// next state of macrocell
-	Macrocell* result;
+	Macrocell_Ref nw;
+	Macrocell_Ref ne;
+	Macrocell_Ref se;
+	Macrocell_Ref sw;
+	// next state of macrocell (lower 32 bit), exponent of its generations + 1 (8 bit; 0 if there is no result) and population (upper 24 bit)
+	// they are packed into one word, so a result is always read together with its exponent; it may be written by several threads (always the same value)
+	std::atomic<uint64_t> info;
+
+	// num of living zero level cells in macrocell is saturated at saturated_population (use get_population() to get the exact value)
+	static constexpr std::size_t population_shift = 40;
+	static constexpr uint32_t saturated_population = (1u << (64 - population_shift)) - 1;
+	// spread the 32 bits of value to the even bits of the result
+	static inline uint64_t spread_bits(uint64_t value)
+	{
+		value = (value | (value << 16)) & 0x0000FFFF0000FFFFull;
+		value = (value | (value << 8)) & 0x00FF00FF00FF00FFull;
+		value = (value | (value << 4)) & 0x0F0F0F0F0F0F0F0Full;
+		value = (value | (value << 2)) & 0x3333333333333333ull;
+		return (value | (value << 1)) & 0x5555555555555555ull;
+	}
+
+	// stored exponent of results of 2^(level - 2) generations (the largest step of a cell); so the exponent field does not limit the level
+	static constexpr std::size_t full_speed = 0xFE;
+	// largest exponent of a step smaller than full speed; steps of HashLife_System are limited to 2^(max_exponent + 1) - 1 generations
+	static constexpr std::size_t max_exponent = full_speed - 1;
 
 	// return macrocell with given daughter cells; if cell does not exist in hash_table, a new cell is created and inserted into the hash_table
-	static Macrocell* new_macrocell(Macrocell* nw, Macrocell* ne, Macrocell* se, Macrocell* sw);
+	static Macrocell_Ref new_macrocell(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw);
+	// store macrocells with given daughter cells (nw, ne, se, sw) of count entries in cells like new_macrocell(); their slots in hash_table are prefetched together
+	static inline void new_macrocells(std::size_t count, const Macrocell_Ref (*daughters)[4], Macrocell_Ref* cells) { hash_table.find_or_create(count, daughters, cells); }
 
-	// init instance; if ne == nullptr, the cell will be a zero level cell; nw != nullptr sets the population of a zero level cell to 1, otherwise it is 0
-	Macrocell(Macrocell* nw, Macrocell* ne, Macrocell* se, Macrocell* sw);
+	// return leaf with given cells (bit y * 8 + x is the cell at x,y); if cell does not exist in hash_table, a new cell is created and inserted into the hash_table
+	static inline Macrocell_Ref new_leaf(uint64_t bits)
+	{
+		return new_macrocell(Macrocell_Ref(static_cast<uint32_t>(bits)), Macrocell_Ref(static_cast<uint32_t>(bits >> 32)), nullptr, nullptr);
+	}
+	// largest level of cells built by build(); the morton codes of their positions fit into 64 bit
+	static constexpr std::size_t max_build_level = 32;
+	// return morton code of given position (bits of x and y interleaved, x in the even bits); sorted codes visit the cells in the order of the daughter cells (nw, ne, sw, se) at each level
+	static inline uint64_t morton_code(uint32_t x, uint32_t y) { return spread_bits(x) | (spread_bits(y) << 1); }
+	// return cell of given level (leaf_level + 1 to max_build_level) whose living cells are given by the morton codes of their positions; cells is sorted and deduplicated
+	// the cells are built bottom-up in one pass over the sorted codes, so each macrocell is looked up once and no intermediate cells are created
+	static Macrocell_Ref build(std::vector<uint64_t>& cells, std::size_t level);
+
+	// return center leaf of the 16x16 cells given by four leaves
+	static Macrocell_Ref leaf_center(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw);
+
+	// smallest level of cells whose results are looked up in their images if symmetric is true
+	static constexpr std::size_t symmetry_level = leaf_level + 3;
+	// images are cached in the result cache of hash_table with exponent image_exp + transformation
+	static constexpr std::size_t image_exp = 0x100;
+	// missing images (not in hash_table) are cached with exponent missing_image_exp + transformation (the result is the cell itself)
+	static constexpr std::size_t missing_image_exp = 0x110;
+	// a cell without image result of 2^exp generations is cached with exponent no_image_exp + exp (the result is the cell itself), so its images are looked up only once
+	static constexpr std::size_t no_image_exp = 0x200;
+	// return image of given cell after given transformation (0 - 7): bit 2 transposes the cells, then bit 0 mirrors them horizontally and bit 1 vertically
+	// if create is false, nullptr is returned if the image does not exist in hash_table
+	static Macrocell_Ref transform(Macrocell_Ref cell, std::size_t transformation, bool create);
+	// return transformation which reverts given transformation
+	static inline std::size_t inverse(std::size_t transformation) { return (transformation & 0x04) ? (0x04 | ((transformation & 0x01) << 1) | ((transformation >> 1) & 0x01)) : transformation; }
+
+	// init instance; if se == nullptr, the cell will be a leaf whose cells are given by nw and ne
+	Macrocell(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw);
+
+	// return true if cell is a leaf
+	inline bool is_leaf() const { return se == nullptr; }
+	// return cells of leaf; bit y * 8 + x is the cell at x,y
+	inline uint64_t get_bits() const { return nw.get_index() | (static_cast<uint64_t>(ne.get_index()) << 32); }
+
+	// return exact num of living zero level cells; saturated populations are summed up from the daughter cells
+	// the result has to fit into std::size_t; use get_big_population() for larger cells
+	std::size_t get_population() const;
+	Big_Integer get_big_population() const;
+	// return num of living zero level cells up to saturated_population
+	inline uint32_t get_saturated_population() const { return static_cast<uint32_t>(info.load(std::memory_order_relaxed) >> population_shift); }
+	// return true if there are no living cells
+	inline bool is_empty() const { return get_saturated_population() == 0; }
+
+	// return result of 2^exp generations; return nullptr if it is not stored in macrocell
+	inline Macrocell_Ref get_result(std::size_t exp) const
+	{
+		uint64_t value = info.load(std::memory_order_acquire);
+		return (((value >> 32) & 0xFF) == exp + 1) ? Macrocell_Ref(static_cast<uint32_t>(value)) : Macrocell_Ref(nullptr);
+	}
+	// return stored result of any num of generations; return nullptr if there is no result
+	inline Macrocell_Ref get_result() const { return Macrocell_Ref(static_cast<uint32_t>(info.load(std::memory_order_acquire))); }
+	// store result of 2^exp generations of given cell; a replaced result of another exponent is kept in the result cache of hash_table
+	static void set_result(Macrocell_Ref cell, std::size_t exp, Macrocell_Ref result);
 
 	// return the hashed value of the daughter cells
 	inline std::size_t hash() const;
 
-	// calculate level of cell
+	// calculate level of cell + 1
 	std::size_t level() const
 	{
 		const Macrocell* temp = this;
-		std::size_t level = 0;
-		while(temp)
+		std::size_t level = leaf_level + 1;
+		while(!temp->is_leaf())
 		{
 			++level;
-			temp = temp->ne;
+			temp = temp->ne.get();
 		}
 
 		return level;
 	}
 
 	// set zero level cell at x,y to given state; upper left corner is 0,0
-	Macrocell* set_state(std::size_t x, std::size_t y, std::size_t level, Cell_State state);
+	Macrocell_Ref set_state(std::size_t x, std::size_t y, std::size_t level, Cell_State state);
 	// get zero level cell state at x,y; upper left corner is 0,0
 	inline bool get_state(std::size_t x, std::size_t y, std::size_t level) const
 	{
-		if(population == 0)
+		if(is_empty())
 			return false;
-		if(level == 0)
-			return population;
+		if(is_leaf())
+			return (get_bits() >> (y * 8 + x)) & 0x01;
 
 		std::size_t half = 0x01ull << (--level);
 		if(x < half)
@@ -73,34 +178,111 @@ struct Macrocell
 		}
 	}
 
-	// generations has to be a power of two
-	Macrocell* calculate(std::size_t level, std::size_t generations = 1);
+	// call function(x, y, population) for each non-empty block of 2^block_level x 2^block_level cells of given cell (at x,y) which intersects the rectangle x_begin,y_begin - x_end,y_end (ends exclusive)
+	// empty macrocells are skipped without descending, so the costs depend on the living cells instead of the area; positions are given in zero level cells
+	template<typename Function>
+	static void for_each_block(Macrocell_Ref cell, std::size_t level, std::size_t x, std::size_t y, std::size_t block_level,
+							   std::size_t x_begin, std::size_t y_begin, std::size_t x_end, std::size_t y_end, Function& function);
+
+	// return center of given cell after 2^min(generations, level - 2) generations; results are stored per exponent, so changing generations keeps all results
+	// generations is the exponent of a power of two (at most max_exponent if it is smaller than level - 2); if pool is given, the daughter results of cells with at least parallel_level are calculated by its threads
+	// the cells are evaluated with an explicit stack instead of recursion; if control is given, its progress is raised and nullptr is returned if it is cancelled
+	static Macrocell_Ref calculate(Macrocell_Ref cell, std::size_t level, std::size_t generations = 1, Task_Pool* pool = nullptr, Calculation_Control* control = nullptr);
+
+	// return center of given cell after 2^min(generations, level - 2) generations like calculate(), but only its cells inside the rectangle x_begin,y_begin - x_end,y_end (positions in given cell, ends exclusive) are calculated
+	// only daughter cells in the light cone of the rectangle are calculated; cells of the result outside the rectangle are undefined, so the result is not stored
+	static Macrocell_Ref calculate_region(Macrocell_Ref cell, std::size_t level, std::size_t generations,
+										  std::size_t x_begin, std::size_t y_begin, std::size_t x_end, std::size_t y_end, Task_Pool* pool = nullptr);
 
 	// get macrocell of level n-1 which is located in the center
-	inline Macrocell* center() const
+	inline Macrocell_Ref center() const
 	{
 	   return new_macrocell(nw->se, ne->sw, se->nw, sw->ne);
 	}
 	// get macrocell of level n-1 which is located in the north
-	inline Macrocell* nn() const
+	inline Macrocell_Ref nn() const
 	{
 		return new_macrocell(nw->ne, ne->nw, ne->sw, nw->se);
 	}
 	// get macrocell of level n-1 which is located in the east
-	inline Macrocell* ee() const
+	inline Macrocell_Ref ee() const
 	{
 		return new_macrocell(ne->sw, ne->se, se->ne, se->nw);
 	}
 	// get macrocell of level n-1 which is located in the south
-	inline Macrocell* ss() const
+	inline Macrocell_Ref ss() const
 	{
 		return new_macrocell(sw->ne, se->nw, se->sw, sw->se);
 	}
 	// get macrocell of level n-1 which is located in the west
-	inline Macrocell* ww() const
+	inline Macrocell_Ref ww() const
 	{
 		return new_macrocell(nw->sw, nw->se, sw->ne, sw->nw);
 	}
 };
 
+template<typename Function>
+void Macrocell::for_each_block(Macrocell_Ref cell, std::size_t level, std::size_t x, std::size_t y, std::size_t block_level,
+							   std::size_t x_begin, std::size_t y_begin, std::size_t x_end, std::size_t y_end, Function& function)
+{
+	const std::size_t size = 0x01ull << level;
+	if(cell->is_empty() || x >= x_end || y >= y_end || x + size <= x_begin || y + size <= y_begin)
+		return;
+
+	if(level == block_level)
+	{
+		function(x, y, cell->get_population());
+		return;
+	}
+
+	if(cell->is_leaf())
+	{
+		// blocks smaller than a leaf are counted in its bitboard
+		const std::size_t block_size = 0x01ull << block_level;
+		const uint64_t row_mask = (0x01ull << block_size) - 1;
+		const uint64_t bits = cell->get_bits();
+		for(std::size_t block_y = 0; block_y < size; block_y += block_size)
+		{
+			for(std::size_t block_x = 0; block_x < size; block_x += block_size)
+			{
+				if(x + block_x >= x_end || y + block_y >= y_end || x + block_x + block_size <= x_begin || y + block_y + block_size <= y_begin)
+					continue;
+
+				uint64_t mask = 0;
+				for(std::size_t row = block_y; row < block_y + block_size; ++row)
+					mask |= row_mask << (row * size + block_x);
+				if(bits & mask)
+					function(x + block_x, y + block_y, std::bitset<64>(bits & mask).count());
+			}
+		}
+		return;
+	}
+
+	const std::size_t half = size >> 1;
+	for_each_block(cell->nw, level - 1, x, y, block_level, x_begin, y_begin, x_end, y_end, function);
+	for_each_block(cell->ne, level - 1, x + half, y, block_level, x_begin, y_begin, x_end, y_end, function);
+	for_each_block(cell->sw, level - 1, x, y + half, block_level, x_begin, y_begin, x_end, y_end, function);
+	for_each_block(cell->se, level - 1, x + half, y + half, block_level, x_begin, y_begin, x_end, y_end, function);
+}
+
+inline Macrocell* Macrocell_Arena::get(uint32_t index) const
+{
+	return slabs[index >> slab_bits] + (index & (cells_per_slab - 1));
+}
+
+inline Macrocell* Macrocell_Ref::get() const
+{
+	return Macrocell::hash_table.get_cell(index);
+}
+
+inline Macrocell* Macrocell_Ref::operator->() const
+{
+	return get();
+}
+
+inline Macrocell& Macrocell_Ref::operator*() const
+{
+	return *get();
+}
+
 #endif // HASHLIFEMACROCELL_H
@@ -0,0 +1,365 @@
+// © Copyright (c) 2018 SqYtCO
+
+#include "hashlifestore.h"
+#include "hashlifemacrocell.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+struct Store_Header
+{
+	char magic[8];
+	std::uint64_t survival_rules;
+	std::uint64_t rebirth_rules;
+	std::uint64_t num_of_records;
+	std::uint64_t num_of_results;
+};
+// records are written without key; the keys are calculated again while reading
+struct Store_Record
+{
+	std::uint64_t bits;
+	std::uint32_t daughters[4];
+};
+struct Store_Result
+{
+	std::uint64_t key_low;
+	std::uint64_t key_high;
+	std::uint64_t exp;
+	std::uint64_t record;
+};
+
+static constexpr char store_magic[8] = { 'G', 'O', 'L', 'S', 'T', 'O', 'R', '1' };
+
+// bijective mixing function (finalizer of splitmix64)
+static inline uint64_t mix(uint64_t value)
+{
+	value ^= value >> 30;
+	value *= 0xBF58476D1CE4E5B9ull;
+	value ^= value >> 27;
+	value *= 0x94D049BB133111EBull;
+	value ^= value >> 31;
+	return value;
+}
+
+HashLife_Store::Key HashLife_Store::leaf_key(uint64_t bits)
+{
+	// both halves are bijective, so different leaves never have the same key
+	return Key{ mix(bits ^ 0x6A09E667F3BCC908ull), mix(bits ^ 0xBB67AE8584CAA73Bull) };
+}
+
+HashLife_Store::Key HashLife_Store::cell_key(const Key& nw, const Key& ne, const Key& se, const Key& sw)
+{
+	// both halves are calculated independently with different seeds
+	uint64_t low = 0x3C6EF372FE94F82Bull, high = 0xA54FF53A5F1D36F1ull;
+	for(const Key* a : { &nw, &ne, &se, &sw })
+	{
+		low = mix(low + a->low);
+		high = mix(high ^ a->high) + 0x9E3779B97F4A7C15ull;
+	}
+	return Key{ low, high };
+}
+
+HashLife_Store::HashLife_Store(const std::string& file, std::size_t max_size, std::size_t survival_rules, std::size_t rebirth_rules) : file(file), max_size(max_size),
+	survival_rules(survival_rules), rebirth_rules(rebirth_rules), memo_collections(Macrocell::hash_table.get_num_of_collections())
+{
+	std::ifstream in(file, std::ios::binary);
+	Store_Header header;
+	// check file type and rules
+	if(!in || !in.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, store_magic, sizeof(store_magic)) != 0 ||
+			header.survival_rules != survival_rules || header.rebirth_rules != rebirth_rules)
+		return;
+
+	for(std::size_t i = 0; i < header.num_of_records; ++i)
+	{
+		Store_Record stored;
+		if(!in.read(reinterpret_cast<char*>(&stored), sizeof(stored)))
+		{
+			clear();
+			return;
+		}
+
+		Record record;
+		record.bits = stored.bits;
+		std::memcpy(record.daughters, stored.daughters, sizeof(record.daughters));
+		if(record.daughters[0] == leaf_record)
+		{
+			record.key = leaf_key(record.bits);
+			record.level = Macrocell::leaf_level;
+		}
+		else
+		{
+			// daughter records have to be in front and of the same level
+			for(auto a : record.daughters)
+			{
+				if(a >= i || records[a].level != records[record.daughters[0]].level)
+				{
+					clear();
+					return;
+				}
+			}
+
+			record.key = cell_key(records[record.daughters[0]].key, records[record.daughters[1]].key, records[record.daughters[2]].key, records[record.daughters[3]].key);
+			record.level = records[record.daughters[0]].level + 1;
+		}
+
+		record_of_key.emplace(record.key, static_cast<uint32_t>(records.size()));
+		records.push_back(record);
+	}
+
+	for(std::size_t i = 0; i < header.num_of_results; ++i)
+	{
+		Store_Result stored;
+		if(!in.read(reinterpret_cast<char*>(&stored), sizeof(stored)) || stored.record >= records.size() || !valid_result(records[stored.record].level, stored.exp))
+		{
+			clear();
+			return;
+		}
+
+		Result result{ Result_Key{ Key{ stored.key_low, stored.key_high }, static_cast<std::size_t>(stored.exp) }, static_cast<uint32_t>(stored.record) };
+		results.push_back(result);
+		result_of_key.emplace(result.key, std::prev(results.end()));
+	}
+
+	// the limit may be lower than in the previous session
+	if(get_size() > max_size)
+		shrink(max_size / 4 * 3);
+}
+
+bool HashLife_Store::valid_result(std::size_t record_level, std::size_t exp)
+{
+	// only cells of at least min_level are stored; their results are one level smaller and advance at most 2^(level - 2) generations (full_speed) or a smaller power of two
+	return record_level + 1 >= min_level && (exp == Macrocell::full_speed || exp + 1 < record_level);
+}
+
+void HashLife_Store::clear()
+{
+	records.clear();
+	record_of_key.clear();
+	results.clear();
+	result_of_key.clear();
+	cells.clear();
+}
+
+bool HashLife_Store::write()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::ofstream out(file, std::ios::binary);
+	// if creating fails
+	if(!out)
+		return false;
+
+	Store_Header header;
+	std::memcpy(header.magic, store_magic, sizeof(store_magic));
+	header.survival_rules = survival_rules;
+	header.rebirth_rules = rebirth_rules;
+	header.num_of_records = records.size();
+	header.num_of_results = results.size();
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	for(const auto& a : records)
+	{
+		Store_Record stored;
+		stored.bits = a.bits;
+		std::memcpy(stored.daughters, a.daughters, sizeof(stored.daughters));
+		out.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+	}
+	// most recently used results first; the order is restored by reading
+	for(const auto& a : results)
+	{
+		Store_Result stored{ a.key.cell.low, a.key.cell.high, a.key.exp, a.record };
+		out.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+	}
+
+	return static_cast<bool>(out);
+}
+
+void HashLife_Store::check_memos()
+{
+	// indices of released macrocells are reused by other macrocells; the memos are cleared instead of dropping results to keep their limit
+	if(Macrocell::hash_table.get_num_of_collections() != memo_collections || (keys.size() + cells.size()) * memo_size > max_size / 4)
+	{
+		keys.clear();
+		cells.clear();
+		memo_collections = Macrocell::hash_table.get_num_of_collections();
+	}
+}
+
+HashLife_Store::Key HashLife_Store::get_key(Macrocell_Ref cell, std::size_t level)
+{
+	if(cell->is_leaf())
+		return leaf_key(cell->get_bits());
+
+	if(level >= memo_level)
+	{
+		auto found = keys.find(cell.get_index());
+		if(found != keys.end())
+			return found->second;
+	}
+
+	Key key = cell_key(get_key(cell->nw, level - 1), get_key(cell->ne, level - 1), get_key(cell->se, level - 1), get_key(cell->sw, level - 1));
+	if(level >= memo_level)
+		keys.emplace(cell.get_index(), key);
+
+	return key;
+}
+
+uint32_t HashLife_Store::add_record(Macrocell_Ref cell, std::size_t level)
+{
+	const Key key = get_key(cell, level);
+	auto found = record_of_key.find(key);
+	if(found != record_of_key.end())
+		return found->second;
+
+	Record record;
+	record.key = key;
+	record.level = static_cast<uint32_t>(level);
+	if(cell->is_leaf())
+	{
+		record.bits = cell->get_bits();
+		record.daughters[0] = leaf_record;
+	}
+	else
+	{
+		record.bits = 0;
+		record.daughters[0] = add_record(cell->nw, level - 1);
+		record.daughters[1] = add_record(cell->ne, level - 1);
+		record.daughters[2] = add_record(cell->se, level - 1);
+		record.daughters[3] = add_record(cell->sw, level - 1);
+	}
+
+	record_of_key.emplace(key, static_cast<uint32_t>(records.size()));
+	records.push_back(record);
+	return static_cast<uint32_t>(records.size() - 1);
+}
+
+Macrocell_Ref HashLife_Store::get_cell(uint32_t record, std::size_t level)
+{
+	const Record& stored = records[record];
+	if(stored.daughters[0] == leaf_record)
+		return Macrocell::new_leaf(stored.bits);
+
+	if(level >= memo_level)
+	{
+		auto found = cells.find(record);
+		if(found != cells.end())
+			return found->second;
+	}
+
+	Macrocell_Ref cell = Macrocell::new_macrocell(get_cell(stored.daughters[0], level - 1), get_cell(stored.daughters[1], level - 1),
+												  get_cell(stored.daughters[2], level - 1), get_cell(stored.daughters[3], level - 1));
+	if(level >= memo_level)
+		cells.emplace(record, cell);
+
+	return cell;
+}
+
+void HashLife_Store::shrink(std::size_t size)
+{
+	// mark records of the most recently used results until the size is reached; results which do not fit any more are dropped
+	std::vector<bool> marks(records.size(), false);
+	std::vector<uint32_t> stack, marked;
+	std::size_t used = 0;
+	for(auto a = results.begin(); a != results.end(); )
+	{
+		marked.clear();
+		stack.push_back(a->record);
+		while(!stack.empty())
+		{
+			const uint32_t record = stack.back();
+			stack.pop_back();
+			if(marks[record])
+				continue;
+
+			marks[record] = true;
+			marked.push_back(record);
+			if(records[record].daughters[0] != leaf_record)
+				stack.insert(stack.end(), records[record].daughters, records[record].daughters + 4);
+		}
+
+		// a large result is dropped, but less recently used smaller results may still fit
+		if(used + result_size + marked.size() * record_size > size)
+		{
+			for(auto b : marked)
+				marks[b] = false;
+			result_of_key.erase(a->key);
+			a = results.erase(a);
+		}
+		else
+		{
+			used += result_size + marked.size() * record_size;
+			++a;
+		}
+	}
+
+	// remove unmarked records; the order is kept, so daughter records stay in front of their parents
+	std::vector<uint32_t> new_index(records.size(), leaf_record);
+	std::size_t kept = 0;
+	for(std::size_t i = 0; i < records.size(); ++i)
+	{
+		if(!marks[i])
+			continue;
+
+		Record record = records[i];
+		if(record.daughters[0] != leaf_record)
+			for(auto& a : record.daughters)
+				a = new_index[a];
+		new_index[i] = static_cast<uint32_t>(kept);
+		records[kept++] = record;
+	}
+	records.resize(kept);
+
+	record_of_key.clear();
+	for(std::size_t i = 0; i < records.size(); ++i)
+		record_of_key.emplace(records[i].key, static_cast<uint32_t>(i));
+	for(auto& a : results)
+		a.record = new_index[a.record];
+	cells.clear();
+}
+
+Macrocell_Ref HashLife_Store::get_result(Macrocell_Ref cell, std::size_t level, std::size_t exp)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	check_memos();
+
+	auto found = result_of_key.find(Result_Key{ get_key(cell, level), exp });
+	// the key does not contain the level; a result of another level is a collision of keys
+	if(found == result_of_key.end() || records[found->second->record].level + 1 != level)
+		return nullptr;
+
+	// move to the most recently used results
+	results.splice(results.begin(), results, found->second);
+	return get_cell(found->second->record, level - 1);
+}
+
+void HashLife_Store::set_result(Macrocell_Ref cell, std::size_t level, std::size_t exp, Macrocell_Ref result)
+{
+	std::lock_guard<std::mutex> lock(pending_mutex);
+	pending.push_back(Pending_Result{ cell, level, exp, result });
+}
+
+void HashLife_Store::merge_results()
+{
+	std::vector<Pending_Result> merged;
+	{
+		std::lock_guard<std::mutex> lock(pending_mutex);
+		merged.swap(pending);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for(const auto& a : merged)
+	{
+		check_memos();
+
+		const Result_Key key{ get_key(a.cell, a.level), a.exp };
+		if(result_of_key.count(key))
+			continue;
+
+		results.push_front(Result{ key, add_record(a.result, a.level - 1) });
+		result_of_key.emplace(key, results.begin());
+
+		// shrink below the limit, so the results are not dropped one by one
+		if(get_size() > max_size)
+			shrink(max_size / 4 * 3);
+	}
+}
@@ -0,0 +1,143 @@
+// © Copyright (c) 2018 SqYtCO
+
+#ifndef HASHLIFESTORE_H
+#define HASHLIFESTORE_H
+
+#include "hashlifearena.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* persistent store of results of large macrocells; it is read from a file by the ctor and written back by write()
+ * macrocells are identified by a 128-bit hash of their content (key) instead of their index, so results are found again in later sessions and in other patterns containing the same cells
+ * the store keeps an own copy of the results (records of 8x8 cells or of four daughter records), because macrocells are released by garbage collection and do not exist in the next session
+ * if the records exceed the size limit, the least recently used results are dropped; a file is only used with the rules it was written with */
+class HashLife_Store
+{
+	// 128-bit hash of the content of a macrocell
+	struct Key
+	{
+		uint64_t low;
+		uint64_t high;
+
+		inline bool operator==(const Key& other) const { return low == other.low && high == other.high; }
+	};
+	struct Key_Hash
+	{
+		inline std::size_t operator()(const Key& key) const { return static_cast<std::size_t>(key.low); }
+	};
+	// cell and exponent of a stored result
+	struct Result_Key
+	{
+		Key cell;
+		std::size_t exp;
+
+		inline bool operator==(const Result_Key& other) const { return cell == other.cell && exp == other.exp; }
+	};
+	struct Result_Key_Hash
+	{
+		inline std::size_t operator()(const Result_Key& key) const { return static_cast<std::size_t>(key.cell.low ^ (key.exp * 0x9E3779B97F4A7C15ull)); }
+	};
+
+	// copy of a macrocell; a leaf stores its cells in bits and leaf_record in daughters[0], other records store the indices of their daughter records (nw, ne, se, sw)
+	// daughter records are always in front of their parent, so the records can be read in order; the level is not written, it is calculated again while reading
+	struct Record
+	{
+		Key key;
+		uint64_t bits;
+		uint32_t daughters[4];
+		uint32_t level;
+	};
+	static constexpr uint32_t leaf_record = 0xFFFFFFFF;
+	struct Result
+	{
+		Result_Key key;
+		uint32_t record;
+	};
+
+	// estimated bytes of a record and a result including their map entries; used for the size limit
+	static constexpr std::size_t record_size = sizeof(Record) + 48;
+	static constexpr std::size_t result_size = sizeof(Result) + 64;
+	// estimated bytes of an entry of keys or cells
+	static constexpr std::size_t memo_size = sizeof(uint32_t) + sizeof(Key) + 40;
+
+	std::string file;
+	std::size_t max_size;
+	std::size_t survival_rules;
+	std::size_t rebirth_rules;
+
+	std::vector<Record> records;
+	std::unordered_map<Key, uint32_t, Key_Hash> record_of_key;
+	// results ordered by last use (most recently used first)
+	std::list<Result> results;
+	std::unordered_map<Result_Key, std::list<Result>::iterator, Result_Key_Hash> result_of_key;
+
+	// keys of macrocells (by index) and macrocells of records; they are valid until the next garbage collection of the hash table
+	// only cells of at least memo_level (32x32 cells) are kept; the keys of smaller cells are calculated again; they are cleared if they exceed a quarter of max_size
+	static constexpr std::size_t memo_level = 5;
+	std::unordered_map<uint32_t, Key> keys;
+	std::unordered_map<uint32_t, Macrocell_Ref> cells;
+	std::size_t memo_collections;
+
+	std::mutex mutex;
+
+	// results of set_result() which are added to the records by merge_results(); so the calculating threads do not copy the cells while mutex is locked
+	struct Pending_Result
+	{
+		Macrocell_Ref cell;
+		std::size_t level;
+		std::size_t exp;
+		Macrocell_Ref result;
+	};
+	std::vector<Pending_Result> pending;
+	std::mutex pending_mutex;
+
+	// key of given leaf and key of cell with given daughter keys
+	static Key leaf_key(uint64_t bits);
+	static Key cell_key(const Key& nw, const Key& ne, const Key& se, const Key& sw);
+	// return key of given macrocell of given level
+	Key get_key(Macrocell_Ref cell, std::size_t level);
+	// return record of given macrocell; it is added (with missing daughter records) if it does not exist
+	uint32_t add_record(Macrocell_Ref cell, std::size_t level);
+	// return macrocell of given record of given level; it is created if it does not exist
+	Macrocell_Ref get_cell(uint32_t record, std::size_t level);
+	// clear memos if the hash table collected garbage since they were filled or if they exceed their part of the size limit
+	void check_memos();
+	// return true if a stored result may be a record of given level and exponent
+	static bool valid_result(std::size_t record_level, std::size_t exp);
+	// remove all records and results
+	void clear();
+	// keep most recently used results and their records up to given size; the other ones are dropped
+	void shrink(std::size_t size);
+
+public:
+	// smallest level of a macrocell whose results are stored (512x512 cells); smaller cells are calculated faster than looked up
+	static constexpr std::size_t min_level = 9;
+
+	// read given file if it exists and was written with the same rules; otherwise the store is empty; max_size is given in bytes
+	HashLife_Store(const std::string& file, std::size_t max_size, std::size_t survival_rules, std::size_t rebirth_rules);
+
+	HashLife_Store(const HashLife_Store&) = delete;
+	HashLife_Store& operator=(const HashLife_Store&) = delete;
+
+	// write all results to the file; return false if writing fails
+	bool write();
+
+	// return stored result of 2^exp generations of given cell of given level; return nullptr if there is none (thread-safe)
+	Macrocell_Ref get_result(Macrocell_Ref cell, std::size_t level, std::size_t exp);
+	// store result of 2^exp generations of given cell of given level; it is added by the next call of merge_results() (thread-safe)
+	void set_result(Macrocell_Ref cell, std::size_t level, std::size_t exp, Macrocell_Ref result);
+	// add the results of set_result() to the records; the least recently used results are dropped if the size limit is exceeded
+	// it has to be called before the next garbage collection of the hash table (e.g. after Macrocell::calculate())
+	void merge_results();
+
+// get functions
+	inline std::size_t get_num_of_results() const { return results.size(); }
+	// return estimated bytes of all records, results and memos
+	inline std::size_t get_size() const { return records.size() * record_size + results.size() * result_size + (keys.size() + cells.size()) * memo_size; }
+};
+
+#endif // HASHLIFESTORE_H
@@ -1,6 +1,13 @@
 // © Copyright (c) 2018 SqYtCO
 
 #include "hashlifesystem.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 // return exponent of next power of two (if num is no power of two; otherwise exponent of num)
 static inline std::size_t exp_of_next_pow_of_two(std::size_t num)
@@ -29,42 +36,331 @@ static inline std::size_t next_pow_of_two(std::size_t num)
 	return ++num;
 }
 
-HashLife_System::HashLife_System(std::size_t survival_rules, std::size_t rebirth_rules) : Base_System(init_size, init_size), master_cell(nullptr)
+HashLife_System::HashLife_System(std::size_t survival_rules, std::size_t rebirth_rules, std::size_t threads) : Base_System(init_size, init_size), master_cell(nullptr),
+	next_cell(nullptr), next_level(0), next_generations(0), region_x(0), region_y(0), region_width(0), region_generations(0), population(0), population_valid(false), hyperspeed_exp(0), pool((threads > 1) ? new Task_Pool(threads) : nullptr)
 {
+	Macrocell::hash_table.set_concurrent(pool != nullptr);
 	Macrocell::hash_table.set_rule_set(survival_rules, rebirth_rules);
 	resize(init_size);
 }
 
-std::size_t HashLife_System::calc_next_generation(std::size_t generations)
+HashLife_System::~HashLife_System()
 {
-	generations = exp_of_next_pow_of_two(generations);
-	while(generations > (level - 2))
-		resize(size_x * 2);
+	if(store)
+	{
+		Macrocell::store = nullptr;
+		store->write();
+	}
+}
+
+void HashLife_System::open_store(const std::string& file, std::size_t max_size)
+{
+	store.reset(new HashLife_Store(file, max_size, Macrocell::hash_table.get_survival_rules(), Macrocell::hash_table.get_rebirth_rules()));
+	Macrocell::store = store.get();
+}
 
-	if(generations > Macrocell::hash_table.get_precalced_exp())
-		Macrocell::hash_table.clear_results(Macrocell::hash_table.get_precalced_exp() + 2);
-	else if(generations < Macrocell::hash_table.get_precalced_exp())
-		Macrocell::hash_table.clear_results(generations);
+bool HashLife_System::advance(Macrocell_Ref& cell, std::size_t& cell_level, const Big_Integer& generations)
+{
+	// one step of 2^exp generations for each set bit; results are stored per exponent, so results of other step sizes stay valid
+	const std::size_t num_of_bits = generations.bit_length();
+	for(std::size_t exp = 0; exp < num_of_bits; ++exp)
+	{
+		if(!generations.get_bit(exp))
+			continue;
 
-	auto_expand();
+		// a cell of level n advances at most 2^(n - 2) generations and its living cells must not reach the border
+		while(exp > cell_level - 2 || cells_at_border(cell))
+			cell = expand(cell, cell_level++);
 
-	master_cell->result = master_cell->calculate(level, generations);
-	Macrocell::hash_table.set_precalced_exp(generations);
+		// the result is the center of cell; surround it by empty cells again
+		control.done.store(0, std::memory_order_relaxed);
+		Macrocell_Ref result = Macrocell::calculate(cell, cell_level, exp, pool.get(), &control);
+		if(!result)
+			return false;
+		cell = expand(result, cell_level - 1);
+	}
+
+	return true;
+}
+
+Big_Integer HashLife_System::calc_next_generation(const Big_Integer& generations)
+{
+	// larger steps are done in several calls
+	if(generations.bit_length() > Macrocell::max_exponent + 1)
+		return calc_next_generation((Big_Integer(1) << (Macrocell::max_exponent + 1)) - 1);
+
+	next_cell = master_cell;
+	next_level = level;
+	const bool completed = advance(next_cell, next_level, generations);
+	next_generations = generations;
+
+	// free slot arrays which were replaced while the threads of pool used the table
+	Macrocell::hash_table.synchronize();
+
+	// results of a cancelled calculation are kept, so a repeated call continues with them
+	if(!completed)
+	{
+		next_cell = nullptr;
+		return 0;
+	}
 
 	return generations;
 }
 
-std::size_t HashLife_System::next_generation(std::size_t generations)
+Big_Integer HashLife_System::next_generation(const Big_Integer& generations, bool lookahead)
+{
+	// the lookahead may be limited to fewer generations
+	if(next_cell == nullptr || next_generations != generations)
+		calc_next_generation(generations);
+	// the calculation was cancelled
+	if(next_cell == nullptr)
+		return 0;
+
+	const Big_Integer advanced = next_generations;
+	master_cell = next_cell;
+	level = next_level;
+	update_size();
+	root_changed();
+	// without lookahead a step calculates only one state
+	if(lookahead)
+		calc_next_generation(generations);
+
+	return advanced;
+}
+
+Big_Integer HashLife_System::next_hyperspeed_step(std::size_t budget, bool lookahead)
+{
+	std::size_t hits, misses, previous_hits, previous_misses;
+	Macrocell::hash_table.get_result_counts(previous_hits, previous_misses);
+	auto begin = std::chrono::steady_clock::now();
+
+	Big_Integer advanced = next_generation(Big_Integer(1) << hyperspeed_exp, lookahead);
+
+	auto duration = static_cast<std::size_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count());
+	Macrocell::hash_table.get_result_counts(hits, misses);
+	hits -= previous_hits;
+	misses -= previous_misses;
+	const double hit_rate = (hits + misses) ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 1.;
+
+	if(duration > budget || hit_rate < collapsed_hit_rate)
+	{
+		if(hyperspeed_exp > 0)
+			--hyperspeed_exp;
+	}
+	else if(duration < budget / 2 && hit_rate >= min_hit_rate && hyperspeed_exp < Macrocell::max_exponent)
+		++hyperspeed_exp;
+
+	return advanced;
+}
+
+std::size_t HashLife_System::get_window(Macrocell_Ref root, std::size_t level, Macrocell_Ref (&parts)[4])
+{
+	// below the root the window is covered by the inner daughter cells (nw->se, ne->sw, se->nw, sw->ne)
+	static Macrocell_Ref Macrocell::* const daughters[4] = { &Macrocell::nw, &Macrocell::ne, &Macrocell::se, &Macrocell::sw };
+	for(std::size_t i = 0; i < 4; ++i)
+	{
+		parts[i] = (*root).*daughters[i];
+		for(std::size_t part_level = level - 1; part_level >= max_coordinate_level; --part_level)
+			parts[i] = (*parts[i]).*daughters[(i + 2) % 4];
+	}
+
+	return std::min(level, max_coordinate_level) - 1;
+}
+
+// return given cell of given level whose daughter cell in given direction is replaced; below this cell the inner daughter cells are replaced until part_level is reached
+static Macrocell_Ref replace_part(Macrocell_Ref cell, std::size_t level, std::size_t direction, std::size_t inner, Macrocell_Ref part, std::size_t part_level)
 {
-	calc_next_generation(generations);
-	master_cell = master_cell->calculate(level, Macrocell::hash_table.get_precalced());
-	Macrocell::hash_table.set_level(--level);
-	size_x >>= 1;
-	size_y >>= 1;
-	expand();
-	calc_next_generation(generations);
+	if(level == part_level)
+		return part;
 
-	return Macrocell::hash_table.get_precalced();
+	Macrocell_Ref daughters[4] = { cell->nw, cell->ne, cell->se, cell->sw };
+	daughters[direction] = replace_part(daughters[direction], level - 1, inner, inner, part, part_level);
+	return Macrocell::new_macrocell(daughters[0], daughters[1], daughters[2], daughters[3]);
+}
+
+// return index of window part (nw, ne, se, sw) containing given position of window; the position is reduced to the part
+static inline std::size_t find_part(std::size_t& x, std::size_t& y, std::size_t half)
+{
+	const std::size_t part = (x < half) ? ((y < half) ? 0 : 3) : ((y < half) ? 1 : 2);
+	x &= half - 1;
+	y &= half - 1;
+	return part;
+}
+
+Cell_State HashLife_System::get_state(Macrocell_Ref root, std::size_t root_level, std::size_t x, std::size_t y) const
+{
+	Macrocell_Ref parts[4];
+	const std::size_t part_level = get_window(root, root_level, parts);
+	const std::size_t half = 0x01ull << part_level;
+	const std::size_t offset = ((half << 1) - size_x) >> 1;
+	x += offset;
+	y += offset;
+
+	const std::size_t part = find_part(x, y, half);
+	return parts[part]->get_state(x, y, part_level);
+}
+
+void HashLife_System::set_cell(std::size_t x, std::size_t y, Cell_State state)
+{
+	Macrocell_Ref parts[4];
+	const std::size_t part_level = get_window(master_cell, level, parts);
+	const std::size_t half = 0x01ull << part_level;
+	const std::size_t offset = ((half << 1) - size_x) >> 1;
+	x += offset;
+	y += offset;
+
+	const std::size_t part = find_part(x, y, half);
+	master_cell = replace_part(master_cell, level, part, (part + 2) % 4, parts[part]->set_state(x, y, part_level, state), part_level);
+	root_changed();
+}
+
+void HashLife_System::set_living_cells(const std::vector<std::pair<std::size_t, std::size_t>>& cells)
+{
+	root_changed();
+	if(level > Macrocell::max_build_level)
+	{
+		// positions of the window do not fit into morton codes
+		master_cell = Macrocell::hash_table.get_empty(level);
+		for(const auto& a : cells)
+			set_cell(a.first, a.second, Alive);
+		return;
+	}
+
+	const std::size_t offset = ((0x01ull << level) - size_x) >> 1;
+	std::vector<uint64_t> codes;
+	codes.reserve(cells.size());
+	for(const auto& a : cells)
+		codes.push_back(Macrocell::morton_code(static_cast<uint32_t>(a.first + offset), static_cast<uint32_t>(a.second + offset)));
+	master_cell = Macrocell::build(codes, level);
+}
+
+void HashLife_System::random_cells(std::size_t alive, std::size_t dead)
+{
+	master_cell = nullptr;
+	resize(init_size);
+
+	// initialize random generation; generate values between 0 and ("alive" + "dead") for right ratio
+	std::random_device rd;
+	std::mt19937 mt(rd());
+	std::uniform_int_distribution<std::size_t> dist(0, alive + dead - 1);
+
+	std::vector<std::pair<std::size_t, std::size_t>> cells;
+	for(std::size_t row = 0; row < size_y; ++row)
+		for(std::size_t column = 0; column < size_x; ++column)
+			if(dist(mt) < alive)
+				cells.emplace_back(column, row);
+	set_living_cells(cells);
+
+	calc_next_generation();
+}
+
+void HashLife_System::get_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, Cell_State* current, Cell_State* next) const
+{
+	std::fill_n(current, width * height, Dead);
+	for_each_block(x, y, x + width, y + height, 0, [=] (std::size_t cell_x, std::size_t cell_y, std::size_t) { current[(cell_y - y) * width + cell_x - x] = Alive; });
+
+	// if the next state is not calculated (e.g. after setting cells or a cancelled step), the cells are shown unchanged
+	if(next && next_cell == nullptr)
+	{
+		std::copy_n(current, width * height, next);
+		// the precalculated part of the rectangle is copied row by row
+		if(region_states.empty())
+			return;
+		const std::size_t region_height = region_states.size() / region_width;
+		const std::size_t x_begin = std::max(x, region_x), x_end = std::min(x + width, region_x + region_width);
+		const std::size_t y_begin = std::max(y, region_y), y_end = std::min(y + height, region_y + region_height);
+		for(std::size_t row = y_begin; row < y_end && x_begin < x_end; ++row)
+			std::copy(region_states.begin() + static_cast<std::ptrdiff_t>((row - region_y) * region_width + x_begin - region_x),
+					  region_states.begin() + static_cast<std::ptrdiff_t>((row - region_y) * region_width + x_end - region_x), next + (row - y) * width + x_begin - x);
+	}
+	else if(next)
+	{
+		std::fill_n(next, width * height, Dead);
+		for_each_block(x, y, x + width, y + height, 0, [=] (std::size_t cell_x, std::size_t cell_y, std::size_t) { next[(cell_y - y) * width + cell_x - x] = Alive; }, true);
+	}
+}
+
+bool HashLife_System::get_future_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, const Big_Integer& generations, Cell_State* states) const
+{
+	std::fill(states, states + width * height, Dead);
+	// the light cone grows by one cell per generation
+	if(!generations.fits_size_t() || generations.to_size_t() >= (0x01ull << (max_coordinate_level - 2)))
+		return false;
+
+	// positions in root are the visible positions + offset
+	Macrocell_Ref root = master_cell;
+	std::size_t root_level = level;
+	if(level > max_coordinate_level)
+	{
+		Macrocell_Ref parts[4];
+		root_level = get_window(master_cell, level, parts) + 1;
+		root = Macrocell::new_macrocell(parts[0], parts[1], parts[2], parts[3]);
+	}
+	std::size_t offset = ((0x01ull << root_level) - size_x) >> 1;
+
+	// return true if the rectangle expanded by given margin is inside the center of root
+	auto in_center = [&] (std::size_t margin)
+	{
+		const std::size_t quarter = 0x01ull << (root_level - 2);
+		return x + offset >= quarter + margin && y + offset >= quarter + margin && x + offset + width + margin <= 3 * quarter && y + offset + height + margin <= 3 * quarter;
+	};
+
+	// one step of 2^exp generations for each set bit; the rectangle of each step is expanded by the generations of the following steps
+	std::size_t remaining = generations.to_size_t();
+	for(std::size_t exp = generations.bit_length(); exp-- > 0; )
+	{
+		if(!generations.get_bit(exp))
+			continue;
+		remaining -= 0x01ull << exp;
+
+		// the result (center of root) has to contain the light cone of the rectangle
+		while(exp > root_level - 2 || !in_center(remaining))
+		{
+			if(root_level == max_coordinate_level)
+				return false;
+			root = expand(root, root_level);
+			offset += 0x01ull << (root_level - 1);
+			++root_level;
+		}
+
+		Macrocell_Ref result = Macrocell::calculate_region(root, root_level, exp, x + offset - remaining, y + offset - remaining,
+														   x + offset + width + remaining, y + offset + height + remaining, pool.get());
+		root = expand(result, root_level - 1);
+	}
+
+	auto set_alive = [=] (std::size_t cell_x, std::size_t cell_y, std::size_t) { states[(cell_y - offset - y) * width + cell_x - offset - x] = Alive; };
+	Macrocell::for_each_block(root, root_level, 0, 0, 0, x + offset, y + offset, x + offset + width, y + offset + height, set_alive);
+	return true;
+}
+
+bool HashLife_System::calc_next_region(std::size_t x, std::size_t y, std::size_t width, std::size_t height, const Big_Integer& generations)
+{
+	region_states.clear();
+	if(width == 0 || height == 0)
+		return false;
+
+	std::vector<Cell_State> states(width * height);
+	if(!get_future_cell_states(x, y, width, height, generations, states.data()))
+		return false;
+
+	// free slot arrays which were replaced while the threads of pool used the table
+	Macrocell::hash_table.synchronize();
+
+	region_states = std::move(states);
+	region_x = x;
+	region_y = y;
+	region_width = width;
+	region_generations = generations;
+	return true;
+}
+
+bool HashLife_System::has_next_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, const Big_Integer& generations) const
+{
+	if(next_cell != nullptr)
+		return next_generations == generations;
+
+	return !region_states.empty() && region_generations == generations && x >= region_x && y >= region_y &&
+			x + width <= region_x + region_width && y + height <= region_y + region_states.size() / region_width;
 }
 
 void HashLife_System::resize(std::size_t size)
@@ -73,11 +369,14 @@ void HashLife_System::resize(std::size_t size)
 		return;
 	std::size_t prev_level = level;
 	level = exp_of_next_pow_of_two(size) + 1;
-	size_x = 0x01ull << (level - 1);
-	size_y = size_x;
+	if(level < min_level)
+		level = min_level;
+	update_size();
 
 	Macrocell::hash_table.set_level(level);
 
+	root_changed();
+	hyperspeed_exp = 0;
 	if(master_cell == nullptr)
 	{
 		master_cell = Macrocell::hash_table.get_empty(level);
@@ -85,11 +384,11 @@ void HashLife_System::resize(std::size_t size)
 	}
 	else
 	{
-		Macrocell* new_nw = master_cell->nw;
-		Macrocell* new_ne = master_cell->ne;
-		Macrocell* new_se = master_cell->se;
-		Macrocell* new_sw = master_cell->sw;
-		Macrocell* empty = Macrocell::hash_table.get_empty(level - 2);
+		Macrocell_Ref new_nw = master_cell->nw;
+		Macrocell_Ref new_ne = master_cell->ne;
+		Macrocell_Ref new_se = master_cell->se;
+		Macrocell_Ref new_sw = master_cell->sw;
+		Macrocell_Ref empty = Macrocell::hash_table.get_empty(level - 2);
 
 		int change = static_cast<int>(prev_level) - static_cast<int>(level);
 		while(change-- > 0)
@@ -106,3 +405,165 @@ void HashLife_System::resize(std::size_t size)
 									Macrocell::new_macrocell(empty, new_sw, empty, empty));
 	}
 }
+
+// write given cell of given level and all its daughter cells which are not written yet; return its line number (0 for empty cells)
+static std::size_t write_macrocell(std::ostream& out, Macrocell_Ref cell, std::size_t level, std::unordered_map<uint32_t, std::size_t>& numbers)
+{
+	if(cell->is_empty())
+		return 0;
+	auto found = numbers.find(cell.get_index());
+	if(found != numbers.end())
+		return found->second;
+
+	if(cell->is_leaf())
+	{
+		// rows from top to bottom ('.' = dead, '*' = alive, '$' = end of row); dead cells at the end of a row and empty rows at the end are omitted
+		const uint64_t bits = cell->get_bits();
+		std::string line;
+		for(std::size_t y = 0; y < 8 && (bits >> (y * 8)); ++y)
+		{
+			const uint64_t row = (bits >> (y * 8)) & 0xFF;
+			for(std::size_t x = 0; (row >> x); ++x)
+				line.push_back(((row >> x) & 0x01) ? '*' : '.');
+			line.push_back('$');
+		}
+		out << line << '\n';
+	}
+	else
+	{
+		// the daughter cells are ordered nw, ne, sw, se in the file
+		const std::size_t nw = write_macrocell(out, cell->nw, level - 1, numbers);
+		const std::size_t ne = write_macrocell(out, cell->ne, level - 1, numbers);
+		const std::size_t sw = write_macrocell(out, cell->sw, level - 1, numbers);
+		const std::size_t se = write_macrocell(out, cell->se, level - 1, numbers);
+		out << level << ' ' << nw << ' ' << ne << ' ' << sw << ' ' << se << '\n';
+	}
+
+	const std::size_t number = numbers.size() + 1;
+	numbers.emplace(cell.get_index(), number);
+	return number;
+}
+
+bool HashLife_System::write_macrocells(std::ostream& out) const
+{
+	// an empty root is written as one line, so the file always contains a root
+	if(master_cell->is_empty())
+		out << level << " 0 0 0 0\n";
+	else
+	{
+		std::unordered_map<uint32_t, std::size_t> numbers;
+		write_macrocell(out, master_cell, level, numbers);
+	}
+
+	return static_cast<bool>(out);
+}
+
+bool HashLife_System::parse_macrocells(std::istream& in, std::vector<Macrocell_Line>& lines)
+{
+	// line 0 is the empty cell of any level
+	lines.assign(1, Macrocell_Line{ 0, 0, { 0, 0, 0, 0 } });
+
+	std::string line;
+	while(std::getline(in, line))
+	{
+		if(!line.empty() && line.back() == '\r')
+			line.pop_back();
+		// skip empty lines, header and comments
+		if(line.empty() || line[0] == '[' || line[0] == '#')
+			continue;
+
+		if(line[0] == '.' || line[0] == '*' || line[0] == '$')
+		{
+			// leaf of 8x8 cells
+			uint64_t bits = 0;
+			std::size_t x = 0, y = 0;
+			for(char c : line)
+			{
+				if(c == '$')
+				{
+					x = 0;
+					++y;
+					continue;
+				}
+				if((c != '.' && c != '*') || x > 7 || y > 7)
+					return false;
+				if(c == '*')
+					bits |= 0x01ull << (y * 8 + x);
+				++x;
+			}
+
+			lines.push_back(Macrocell_Line{ Macrocell::leaf_level, bits, { 0, 0, 0, 0 } });
+		}
+		else
+		{
+			std::istringstream values(line);
+			std::size_t cell_level, numbers[4];
+			if(!(values >> cell_level >> numbers[0] >> numbers[1] >> numbers[2] >> numbers[3]) || cell_level <= Macrocell::leaf_level || cell_level > max_file_level)
+				return false;
+
+			// daughter cells have to be written before
+			for(std::size_t i = 0; i < 4; ++i)
+				if(numbers[i] != 0 && (numbers[i] >= lines.size() || lines[numbers[i]].level != cell_level - 1))
+					return false;
+
+			// the file contains nw, ne, sw, se
+			lines.push_back(Macrocell_Line{ cell_level, 0, { numbers[0], numbers[1], numbers[3], numbers[2] } });
+		}
+	}
+
+	return lines.size() > 1;
+}
+
+void HashLife_System::set_macrocells(const std::vector<Macrocell_Line>& lines)
+{
+	// cells by line number; 0 is replaced by the empty cell of the needed level
+	std::vector<Macrocell_Ref> cells(lines.size());
+	for(std::size_t i = 1; i < lines.size(); ++i)
+	{
+		const Macrocell_Line& line = lines[i];
+		if(line.level == Macrocell::leaf_level)
+		{
+			cells[i] = Macrocell::new_leaf(line.bits);
+			continue;
+		}
+
+		Macrocell::hash_table.set_level(line.level);
+		Macrocell_Ref daughters[4];
+		for(std::size_t d = 0; d < 4; ++d)
+			daughters[d] = (line.daughters[d] == 0) ? Macrocell::hash_table.get_empty(line.level - 1) : cells[line.daughters[d]];
+
+		cells[i] = Macrocell::new_macrocell(daughters[0], daughters[1], daughters[2], daughters[3]);
+	}
+
+	// the last cell is the root
+	Macrocell_Ref root = cells.back();
+	std::size_t root_level = lines.back().level;
+
+	if(root_level == Macrocell::leaf_level)
+	{
+		// split single leaf into the inner quarters of four leaves
+		const uint64_t bits = root->get_bits();
+		Macrocell::hash_table.set_level(root_level + 1);
+		root = Macrocell::new_macrocell(Macrocell::new_leaf((bits & 0x000000000F0F0F0Full) << 36), Macrocell::new_leaf((bits & 0x00000000F0F0F0F0ull) << 28),
+										Macrocell::new_leaf((bits & 0xF0F0F0F000000000ull) >> 36), Macrocell::new_leaf((bits & 0x0F0F0F0F00000000ull) >> 28));
+		++root_level;
+	}
+
+	// the living cells have to be visible, so they have to be in the center of master_cell (e.g. a written master_cell)
+	if(root_level < min_level || root->center()->get_big_population() != root->get_big_population())
+		root = expand(root, root_level++);
+	while(root_level < min_level)
+		root = expand(root, root_level++);
+
+	set_master_cell(root, root_level);
+}
+
+bool HashLife_System::read_macrocells(std::istream& in)
+{
+	std::vector<Macrocell_Line> lines;
+	if(!parse_macrocells(in, lines))
+		return false;
+
+	set_macrocells(lines);
+	return true;
+}
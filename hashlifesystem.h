@@ -4,52 +4,155 @@
 #define HASHLIFESYSTEM_H
 
 #include "basesystem.h"
+#include "biginteger.h"
 #include "hashlifemacrocell.h"
+#include "hashlifestore.h"
 #include "hashlifetable.h"
+#include "taskpool.h"
+#include <algorithm>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 // class implements HashLife algorithm
 // algorithm supports only unlimitted fields
 class HashLife_System : public Base_System
 {
-	Macrocell* master_cell;
+	Macrocell_Ref master_cell;
 	std::size_t level;
 
+	// precalculated state after next_generations generations (lookahead) and its level; its center is at the same position as the center of master_cell
+	Macrocell_Ref next_cell;
+	std::size_t next_level;
+	Big_Integer next_generations;
+	// precalculated states of a rectangle after region_generations generations (see calc_next_region()); empty if they are not calculated
+	// they are dropped together with next_cell and read only if next_cell is not calculated
+	std::vector<Cell_State> region_states;
+	std::size_t region_x;
+	std::size_t region_y;
+	std::size_t region_width;
+	Big_Integer region_generations;
+
+	// population of master_cell; it is summed up once per root, because large populations are not stored in the macrocells
+	Big_Integer population;
+	bool population_valid;
+
+	// exponent of the steps of hyperspeed (see next_hyperspeed_step())
+	std::size_t hyperspeed_exp;
+
+	// threads which calculate the upper levels in parallel; nullptr if only one thread is used
+	std::unique_ptr<Task_Pool> pool;
+	// persistent results of large cells; nullptr if it is not opened
+	std::unique_ptr<HashLife_Store> store;
+	// cancellation and progress of the running calculation
+	Calculation_Control control;
+
 	static constexpr std::size_t init_size = 1024;
+	// smallest level of master_cell; cells_at_border() requires that the cells of level - 2 are no leaves
+	static constexpr std::size_t min_level = Macrocell::leaf_level + 3;
+
+	// hyperspeed raises the exponent if at least min_hit_rate of the results were found in memory and lowers it if less than collapsed_hit_rate were found
+	static constexpr double min_hit_rate = 0.75;
+	static constexpr double collapsed_hit_rate = 0.6;
+
+	// set size_x and size_y to the visible part of the window of master_cell
+	inline void update_size()
+	{
+		size_x = 0x01ull << (std::min(level, max_coordinate_level) - 1);
+		size_y = size_x;
+	}
+	// return state of zero level cell at given visible position of given root
+	Cell_State get_state(Macrocell_Ref root, std::size_t root_level, std::size_t x, std::size_t y) const;
+	// return true if given position is inside the precalculated rectangle
+	inline bool in_region(std::size_t x, std::size_t y) const
+	{
+		return !region_states.empty() && x >= region_x && y >= region_y && x - region_x < region_width && y - region_y < region_states.size() / region_width;
+	}
+	// has to be called if master_cell was replaced; drop next_cell, the precalculated rectangle and the population
+	inline void root_changed()
+	{
+		next_cell = nullptr;
+		region_states.clear();
+		population_valid = false;
+	}
 
 public:
-	HashLife_System(std::size_t survival_rules, std::size_t rebirth_rules);
+	// positions are native words, so only the center of 2^max_coordinate_level x 2^max_coordinate_level cells of a larger root (window) can be addressed
+	// the visible cells (size_x x size_y) are the center of the window; the root itself may grow to any level
+	static constexpr std::size_t max_coordinate_level = 63;
+	// largest level of macrocells read from files; each level creates an empty cell and increases the costs of the level arithmetic in advance() and expand()
+	static constexpr std::size_t max_file_level = 1024;
+	// store the four cells (nw, ne, se, sw) covering the window of given root in parts and return their level
+	// if the root is not larger than the window, the parts are its daughter cells; otherwise they are found by descending to the center
+	static std::size_t get_window(Macrocell_Ref root, std::size_t level, Macrocell_Ref (&parts)[4]);
+
+	HashLife_System(std::size_t survival_rules, std::size_t rebirth_rules, std::size_t threads = 1);
+	// the store is written back to its file
+	virtual ~HashLife_System() override;
 
-	virtual void random_cells(std::size_t, std::size_t) override {	}
+	// use the results of given store file (if it exists) and add the results of large cells to it; the file is written when the system is destroyed
+	// the least recently used results are dropped if the store exceeds max_size (bytes)
+	void open_store(const std::string& file, std::size_t max_size);
+	// reuse results of mirrored and rotated images of cells (see Macrocell::symmetric)
+	inline void set_symmetric(bool enable) { Macrocell::symmetric = enable; }
+
+	// fill a new field of init_size x init_size cells with random cells; the ratio is given by alive/dead
+	virtual void random_cells(std::size_t alive, std::size_t dead) override;
 
 	virtual void calc_next_generation() override { calc_next_generation(1); }
 	virtual void next_generation() override { next_generation(1); }
-	// generations has to be a power of 2
-	std::size_t calc_next_generation(std::size_t generations);
-	std::size_t next_generation(std::size_t generations);
+	// calculate state after exactly given num of generations; it is decomposed into steps of powers of two which reuse the stored results
+	// at most 2^(Macrocell::max_exponent + 1) - 1 generations are calculated at once; return num of calculated generations
+	Big_Integer calc_next_generation(const Big_Integer& generations);
+	inline std::size_t calc_next_generation(std::size_t generations) { return calc_next_generation(Big_Integer(generations)).to_size_t(); }
+	// calculate the states of given rectangle after given num of generations only (see get_future_cell_states()); they are read as next states if next_cell is not calculated
+	// so a view of a part of the universe costs proportional to this part; return false if the light cone of the rectangle is too large (nothing is calculated then)
+	bool calc_next_region(std::size_t x, std::size_t y, std::size_t width, std::size_t height, const Big_Integer& generations);
+	// return true if the next states of given rectangle after given num of generations are calculated (by calc_next_generation() or calc_next_region())
+	bool has_next_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, const Big_Integer& generations) const;
+	// advance given num of generations; return num of advanced generations
+	// if lookahead is true, the following state is calculated too (see get_next_cell_state()); otherwise it is calculated by the next call of calc_next_generation()
+	Big_Integer next_generation(const Big_Integer& generations, bool lookahead = true);
+	inline std::size_t next_generation(std::size_t generations, bool lookahead = true) { return next_generation(Big_Integer(generations), lookahead).to_size_t(); }
+
+	// hyperspeed: advance 2^exp generations and adapt the exponent for the next step; return num of advanced generations
+	// the exponent is raised if the step took less than half of given budget (µs) and the hit rate of the results was high; it is lowered if the step exceeded the budget or the hit rate collapsed
+	// so periodic patterns accelerate up to the fastest rate which fits the budget; the exponent is reset by set_master_cell() and resize()
+	Big_Integer next_hyperspeed_step(std::size_t budget, bool lookahead = true);
+	inline std::size_t get_hyperspeed_exponent() const { return hyperspeed_exp; }
 
 	void resize(std::size_t size);
 
-	inline bool cells_at_border()
+	static inline bool cells_at_border(Macrocell_Ref cell)
 	{
 		// living cells at the border of inner macrocell (without empty border-macrocell)
-		return (master_cell->nw->se->nw->population != 0 || master_cell->nw->se->ne->population != 0 || master_cell->nw->se->sw->population != 0 ||
-				  master_cell->ne->sw->nw->population != 0 || master_cell->ne->sw->ne->population != 0 || master_cell->ne->sw->se->population != 0 ||
-				  master_cell->se->nw->ne->population != 0 || master_cell->se->nw->se->population != 0 || master_cell->se->nw->sw->population != 0 ||
-				  master_cell->sw->ne->nw->population != 0 || master_cell->sw->ne->se->population != 0 || master_cell->sw->ne->sw->population != 0);
+		return (!cell->nw->se->nw->is_empty() || !cell->nw->se->ne->is_empty() || !cell->nw->se->sw->is_empty() ||
+				  !cell->ne->sw->nw->is_empty() || !cell->ne->sw->ne->is_empty() || !cell->ne->sw->se->is_empty() ||
+				  !cell->se->nw->ne->is_empty() || !cell->se->nw->se->is_empty() || !cell->se->nw->sw->is_empty() ||
+				  !cell->sw->ne->nw->is_empty() || !cell->sw->ne->se->is_empty() || !cell->sw->ne->sw->is_empty());
+	}
+	inline bool cells_at_border() { return cells_at_border(master_cell); }
+
+	// return cell of level + 1 whose center is given cell of given level
+	static inline Macrocell_Ref expand(Macrocell_Ref cell, std::size_t level)
+	{
+		Macrocell::hash_table.set_level(level + 1);
+		Macrocell_Ref empty_temp = Macrocell::hash_table.get_empty(level - 1);
+		return Macrocell::new_macrocell(Macrocell::new_macrocell(empty_temp, empty_temp, cell->nw, empty_temp),
+										Macrocell::new_macrocell(empty_temp, empty_temp, empty_temp, cell->ne),
+										Macrocell::new_macrocell(cell->se, empty_temp, empty_temp, empty_temp),
+										Macrocell::new_macrocell(empty_temp, cell->sw, empty_temp, empty_temp));
 	}
 
 	inline void expand()
 	{
-		// double size of master_cell
-		Macrocell* empty_temp = Macrocell::hash_table.get_empty(level - 1);
-		master_cell = Macrocell::new_macrocell(Macrocell::new_macrocell(empty_temp, empty_temp, master_cell->nw, empty_temp),
-												Macrocell::new_macrocell(empty_temp, empty_temp, empty_temp, master_cell->ne),
-												Macrocell::new_macrocell(master_cell->se, empty_temp, empty_temp, empty_temp),
-												Macrocell::new_macrocell(empty_temp, master_cell->sw, empty_temp, empty_temp));
-
-		Macrocell::hash_table.set_level(++level);
-		size_x *= 2;
-		size_y *= 2;
+		// double size of master_cell; the visible positions are shifted, so the precalculated rectangle is dropped
+		master_cell = expand(master_cell, level++);
+		update_size();
+		region_states.clear();
 	}
 
 	inline void auto_expand()
@@ -59,20 +162,97 @@ public:
 			expand();
 	}
 
-	std::size_t get_num_of_alive_cells() { return master_cell->population; }
+	// advance given cell of given level by given num of generations; cell and level are replaced by a cell with the same center
+	// generations must be lower than 2^(Macrocell::max_exponent + 1); return false if the calculation was cancelled (cell is not advanced completely)
+	bool advance(Macrocell_Ref& cell, std::size_t& cell_level, const Big_Integer& generations);
 
-// set functions
-public:
-	// set given cell to given state
-	virtual void set_cell(std::size_t x, std::size_t y, Cell_State state) override
+	// cancel the running and all following calculations until it is called with false (thread-safe); cancelled steps advance no generation
+	inline void cancel_calculation(bool cancel) { control.cancel.store(cancel, std::memory_order_relaxed); }
+	// return progress (0 - 1) of the running step of 2^exp generations (thread-safe); a step of several set bits consists of several such steps
+	inline double get_progress() const { return static_cast<double>(control.done.load(std::memory_order_relaxed)) / static_cast<double>(Calculation_Control::total); }
+
+	inline const Big_Integer& get_num_of_alive_cells()
+	{
+		if(!population_valid)
+		{
+			population = master_cell->get_big_population();
+			population_valid = true;
+		}
+		return population;
+	}
+
+	// call function(x, y, population) for each non-empty block of 2^block_level x 2^block_level cells which intersects the rectangle x_begin,y_begin - x_end,y_end (ends exclusive)
+	// block_level must not be greater than get_level() - 2; if next is true, the blocks of the precalculated next state are visited (none if it is not calculated)
+	template<typename Function>
+	void for_each_block(std::size_t x_begin, std::size_t y_begin, std::size_t x_end, std::size_t y_end, std::size_t block_level, Function function, bool next = false) const
+	{
+		Macrocell_Ref cell = (next) ? next_cell : master_cell;
+		if(cell == nullptr)
+			return;
+
+		// the visible cells are the center of the window; the offset is a multiple of the block size
+		Macrocell_Ref parts[4];
+		const std::size_t part_level = get_window(cell, (next) ? next_level : level, parts);
+		const std::size_t half = 0x01ull << part_level;
+		const std::size_t offset = ((half << 1) - size_x) >> 1;
+		auto shifted = [&function, offset] (std::size_t x, std::size_t y, std::size_t population) { function(x - offset, y - offset, population); };
+		x_begin += offset;
+		y_begin += offset;
+		x_end += offset;
+		y_end += offset;
+		Macrocell::for_each_block(parts[0], part_level, 0, 0, block_level, x_begin, y_begin, x_end, y_end, shifted);
+		Macrocell::for_each_block(parts[1], part_level, half, 0, block_level, x_begin, y_begin, x_end, y_end, shifted);
+		Macrocell::for_each_block(parts[2], part_level, half, half, block_level, x_begin, y_begin, x_end, y_end, shifted);
+		Macrocell::for_each_block(parts[3], part_level, 0, half, block_level, x_begin, y_begin, x_end, y_end, shifted);
+	}
+
+	// write root and all its daughter cells in the macrocell format of Golly (.mc); each distinct macrocell is written once, so the size depends on the num of distinct cells instead of the area
+	// the lines are written bottom-up (leaves of 8x8 cells first) and a cell refers to its daughter cells by their line number (0 = empty); the header has to be written before; return false if writing fails
+	bool write_macrocells(std::ostream& out) const;
+	// line of the macrocell format: a leaf contains its 8x8 cells, a larger cell the line numbers of its daughter cells (nw, ne, se, sw; 0 = empty cell)
+	struct Macrocell_Line
+	{
+		std::size_t level;
+		uint64_t bits;
+		std::size_t daughters[4];
+	};
+	// parse macrocells in the macrocell format of Golly (header and comment lines are skipped) into lines without creating any macrocell; lines[0] is the empty cell
+	// return false if the input contains invalid lines (e.g. a level above max_file_level) or no cell
+	static bool parse_macrocells(std::istream& in, std::vector<Macrocell_Line>& lines);
+	// create macrocells of given lines returned by parse_macrocells() and replace the root by the last one; its center is the center of the visible cells
+	void set_macrocells(const std::vector<Macrocell_Line>& lines);
+	// parse macrocells and replace the root by the last one; return false if the input contains invalid lines; the previous root is kept then
+	bool read_macrocells(std::istream& in);
+
+	// return root of all macrocells and its level
+	inline Macrocell_Ref get_master_cell() const { return master_cell; }
+	inline std::size_t get_level() const { return level; }
+	// return root of precalculated next state; nullptr if it is not calculated
+	inline Macrocell_Ref get_next_cell() const { return next_cell; }
+	// replace root by given macrocell (e.g. a previously returned root); the next state has to be calculated afterwards
+	inline void set_master_cell(Macrocell_Ref cell, std::size_t level)
 	{
-		master_cell = master_cell->set_state(x + (size_x >> 1), y + (size_y >> 1), level, state);
+		master_cell = cell;
+		root_changed();
+		hyperspeed_exp = 0;
+		this->level = level;
+		update_size();
+		Macrocell::hash_table.set_level(level);
 	}
 
+// set functions
+public:
+	// set given cell to given state; if the root is larger than the window, the cells between the changed part and the root are replaced
+	virtual void set_cell(std::size_t x, std::size_t y, Cell_State state) override;
+	// replace all cells by given living cells (visible positions); the macrocells are built bottom-up at once (see Macrocell::build()), which is much faster than setting each cell
+	// if the window is larger than 2^Macrocell::max_build_level x 2^Macrocell::max_build_level cells, the cells are set one by one
+	void set_living_cells(const std::vector<std::pair<std::size_t, std::size_t>>& cells);
+
 	// set all cells to given state
 	inline virtual void set_all(Cell_State) override
 	{
 		master_cell = nullptr;
+		root_changed();
 		resize(1024);
 	}
 
@@ -81,17 +261,24 @@ public:
 	// return current cell state at given position
 	virtual inline Cell_State get_cell_state(std::size_t x, std::size_t y) const override
 	{
-		return master_cell->get_state(x + (size_x >> 1), y + (size_y >> 1), level);
+		return get_state(master_cell, level, x, y);
 	}
 
 	// return next cell state at given position; if the algorithm does not calculate next state, keep this implementation
 	virtual inline Cell_State get_next_cell_state(std::size_t x, std::size_t y) const override
 	{
-		if(master_cell->result == nullptr)
-			return Dead;
+		if(next_cell == nullptr)
+			return (in_region(x, y)) ? region_states[(y - region_y) * region_width + x - region_x] : get_cell_state(x, y);
 
-		return master_cell->result->get_state(x, y, level - 1);
+		// next_cell may be larger than master_cell; both centers are at the same position
+		return get_state(next_cell, next_level, x, y);
 	}
+	// copy states of given rectangle after given num of generations into given buffer without advancing the game; only the macrocells in the light cone of the rectangle are calculated
+	// so the costs depend on the rectangle and the generations instead of the whole pattern; return false if the light cone exceeds 2^max_coordinate_level x 2^max_coordinate_level cells
+	// if the root is larger than the window, the cells outside the window are ignored
+	bool get_future_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, const Big_Integer& generations, Cell_State* states) const;
+	// only living cells are visited by for_each_block(); the buffers are cleared before; next states which are not calculated are equal to the current ones
+	virtual void get_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, Cell_State* current, Cell_State* next = nullptr) const override;
 };
 
 #endif // HASHLIFESYSTEM_H
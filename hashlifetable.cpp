@@ -2,12 +2,18 @@
 
 #include "hashlifetable.h"
 #include "hashlifemacrocell.h"
-#include <array>
-
-static inline void hash_combine(std::size_t& seed, const Macrocell* cell)
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+#if defined(__SSE2__) && !defined(__SANITIZE_THREAD__)
+#include <emmintrin.h>
+#endif
+
+static inline void hash_combine(std::size_t& seed, Macrocell_Ref cell)
 {
 	constexpr uint64_t factor = 0xC6A4A7935BD1E995ULL;
-	std::uintptr_t cell_num = reinterpret_cast<std::uintptr_t>(cell);
+	uint64_t cell_num = cell.get_index();
 
 	cell_num *= factor;
 	cell_num ^= cell_num >> 47;
@@ -19,23 +25,63 @@ static inline void hash_combine(std::size_t& seed, const Macrocell* cell)
 	seed += 0xe6546b64;
 }
 
-HashLife_Table::HashLife_Table() : empty_cells(3),
-	  alive_cell(new Macrocell(reinterpret_cast<Macrocell*>(0x01), nullptr, nullptr, nullptr)),
-	  dead_cell(new Macrocell(nullptr, nullptr, nullptr, nullptr)), precalced_gens_exp(0),
-	  survival_rules((1 << 2) | (1 << 3)), rebirth_rules((1 << 3)),
-	  data_pos(1 << 18, 0xFF), data(1 << 18), num_of_elements(0)
+// return area of calling thread; each thread gets an own area, if there are not more threads than areas
+static inline std::size_t current_area(std::size_t num_of_areas)
 {
-	fill_hash_table();
+	static std::atomic<std::size_t> num_of_threads(0);
+	static thread_local const std::size_t area = num_of_threads.fetch_add(1, std::memory_order_relaxed) & (num_of_areas - 1);
+	return area;
+}
+
+// return index of lowest set bit; mask must not be 0
+static inline std::size_t count_trailing_zeros(uint32_t mask)
+{
+#if defined(__GNUC__)
+	return static_cast<std::size_t>(__builtin_ctz(mask));
+#else
+	std::size_t num = 0;
+	while(!(mask & 0x01))
+	{
+		mask >>= 1;
+		++num;
+	}
+	return num;
+#endif
+}
+
+HashLife_Table::Slot_Array::Slot_Array(std::size_t size) : size(size), groups(new Group[size / group_size]),
+	slots(static_cast<Slot*>(::operator new(size * sizeof(Slot)))), num_of_elements(0), successor(nullptr), next_chunk(0), num_of_migrated(0)
+{
+	for(std::size_t i = 0; i < size; ++i)
+		ctrl(i).store(empty_ctrl, std::memory_order_relaxed);
+}
+
+HashLife_Table::Slot_Array::~Slot_Array()
+{
+	// slots are trivially destructible; release memory only
+	::operator delete(slots);
 }
 
-HashLife_Table::~HashLife_Table()
+HashLife_Table::HashLife_Table() : arena(num_of_areas), empty_cells(Macrocell::leaf_level + 1),
+	  survival_rules((1 << 2) | (1 << 3)), rebirth_rules((1 << 3)), current(nullptr),
+	  concurrent(false), cells_after_collection(0), num_of_collections(0), last_collection_time(0), last_reclaimed(0),
+	  result_cache(new Cached_Result[initial_result_cache_size]()), result_cache_size(initial_result_cache_size), num_of_cached_results(0)
 {
-	for(std::size_t i = 0; i < data_pos.size(); ++i)
-		if(!is_empty_slot(data_pos[i]))
-			delete data[i].second;
+	for(auto& a : area_locks)
+		a.clear();
+	for(auto& a : result_counters)
+	{
+		a.hits = 0;
+		a.misses = 0;
+	}
+
+	slot_arrays.emplace_back(new Slot_Array(initial_size));
+	current = slot_arrays.back().get();
+
+	fill_hash_table();
 }
 
-std::size_t HashLife_Table::hash(const Macrocell* macrocell)
+std::size_t HashLife_Table::hash(Macrocell_Ref macrocell)
 {
 	std::size_t return_value = 0;
 	hash_combine(return_value, macrocell->nw);
@@ -45,7 +91,7 @@ std::size_t HashLife_Table::hash(const Macrocell* macrocell)
 	return return_value;
 }
 
-std::size_t HashLife_Table::hash(const Macrocell* nw, const Macrocell* ne, const Macrocell* se, const Macrocell* sw)
+std::size_t HashLife_Table::hash(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
 {
 	std::size_t return_value = 0;
 	hash_combine(return_value, nw);
@@ -61,50 +107,197 @@ void HashLife_Table::set_level(std::size_t new_level)
 
 	while(empty_cells.size() <= new_level)
 	{
-		Macrocell* empty_temp = empty_cells[empty_cells.size() - 1];
+		Macrocell_Ref empty_temp = empty_cells[empty_cells.size() - 1];
 		empty_cells.emplace_back(Macrocell::new_macrocell(empty_temp, empty_temp,empty_temp, empty_temp));
 	}
 }
 
 void HashLife_Table::clear()
 {
-	for(std::size_t i = 0; i < data_pos.size(); ++i)
-		if(!is_empty_slot(data_pos[i]))
+	// release all macrocells at once
+	arena.clear();
+
+	empty_cells.resize(Macrocell::leaf_level + 1);
+	// replace all slot arrays by an empty one
+	slot_arrays.clear();
+	slot_arrays.emplace_back(new Slot_Array(initial_size));
+	current = slot_arrays.back().get();
+	result_cache.reset(new Cached_Result[initial_result_cache_size]());
+	result_cache_size = initial_result_cache_size;
+	num_of_cached_results = 0;
+
+	fill_hash_table();
+	cells_after_collection = arena.get_num_of_cells();
+}
+
+Macrocell_Ref HashLife_Table::get_cached_result(Macrocell_Ref cell, std::size_t exp) const
+{
+	const uint64_t key = (static_cast<uint64_t>(cell.get_index()) << 32) | (exp + 1);
+	for(std::size_t num = cache_position(key); ; num = (num + 1) & (result_cache_size - 1))
+	{
+		uint64_t value = result_cache[num].key.load(std::memory_order_acquire);
+		if(value == 0)
+			return nullptr;
+		if(value == key)
+			return Macrocell_Ref(result_cache[num].result.load(std::memory_order_acquire));
+	}
+}
+
+void HashLife_Table::cache_result(Macrocell_Ref cell, std::size_t exp, Macrocell_Ref result)
+{
+	// keep at least a quarter of entries empty, so lookups terminate; the cache grows in synchronize()
+	if(num_of_cached_results.load(std::memory_order_relaxed) >= result_cache_size / 4 * 3)
+		return;
+
+	const uint64_t key = (static_cast<uint64_t>(cell.get_index()) << 32) | (exp + 1);
+	std::size_t num = cache_position(key);
+	while(true)
+	{
+		uint64_t value = result_cache[num].key.load(std::memory_order_acquire);
+		if(value == 0)
+		{
+			// claim entry; if another thread was faster, check it again
+			if(!result_cache[num].key.compare_exchange_strong(value, key, std::memory_order_acq_rel))
+				continue;
+
+			num_of_cached_results.fetch_add(1, std::memory_order_relaxed);
+			value = key;
+		}
+		// several threads may write the same result
+		if(value == key)
 		{
-			delete data[i].second;
-			data_pos[i] = 0xFF;
+			result_cache[num].result.store(result.get_index(), std::memory_order_release);
+			return;
 		}
 
-	empty_cells.resize(3);
-	alive_cell = new Macrocell(reinterpret_cast<Macrocell*>(0x01), nullptr, nullptr, nullptr);
-	dead_cell = new Macrocell(nullptr, nullptr, nullptr, nullptr);
-	precalced_gens_exp = 0;
-	data_pos.resize(1 << 18);
-	data.resize(1 << 18);
-	num_of_elements = 0;
+		num = (num + 1) & (result_cache_size - 1);
+	}
+}
+
+void HashLife_Table::rebuild_result_cache(std::size_t new_size, const std::vector<bool>* marks)
+{
+	std::unique_ptr<Cached_Result[]> old_cache(std::move(result_cache));
+	const std::size_t old_size = result_cache_size;
 
-	fill_hash_table();
+	result_cache.reset(new Cached_Result[new_size]());
+	result_cache_size = new_size;
+	num_of_cached_results = 0;
+
+	for(std::size_t i = 0; i < old_size; ++i)
+	{
+		uint64_t key = old_cache[i].key.load(std::memory_order_relaxed);
+		Macrocell_Ref result(old_cache[i].result.load(std::memory_order_relaxed));
+		if(key == 0 || !result)
+			continue;
+
+		// drop entries of released cells
+		Macrocell_Ref cell(static_cast<uint32_t>(key >> 32));
+		if(marks && (!(*marks)[find_slot(hash(cell), cell->nw, cell->ne, cell->se, cell->sw)] ||
+					 !(*marks)[find_slot(hash(result), result->nw, result->ne, result->se, result->sw)]))
+			continue;
+
+		cache_result(cell, (key & 0xFFFFFFFF) - 1, result);
+	}
 }
 
-void HashLife_Table::clear_result(Macrocell* cell, std::size_t level, std::size_t last_level)
+void HashLife_Table::count_result(bool hit)
 {
-	if(cell->result == nullptr || cell->ne == nullptr || cell->ne->ne == nullptr || cell->ne->ne->ne == nullptr)
-			return;
+	// usually only one thread uses the counters of an area, so no read-modify-write is required
+	Result_Counter& counter = result_counters[current_area(num_of_areas)];
+	std::atomic<std::size_t>& count = (hit) ? counter.hits : counter.misses;
+	count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void HashLife_Table::get_result_counts(std::size_t& hits, std::size_t& misses) const
+{
+	hits = 0;
+	misses = 0;
+	for(const auto& a : result_counters)
+	{
+		hits += a.hits.load(std::memory_order_relaxed);
+		misses += a.misses.load(std::memory_order_relaxed);
+	}
+}
+
+std::size_t HashLife_Table::get_memory_usage() const
+{
+	std::size_t slots = 0;
+	for(const auto& a : slot_arrays)
+		slots += a->size;
+
+	return arena.get_num_of_cells() * sizeof(Macrocell) + slots * (sizeof(uint8_t) + sizeof(Slot)) + result_cache_size * sizeof(Cached_Result);
+}
 
-	if(level > last_level)
-		cell->result = nullptr;
+bool HashLife_Table::needs_collection(std::size_t memory_limit) const
+{
+	// at least half of the surviving cells have to be created since last collection; this prevents a collection after each step if most cells are reachable
+	return get_memory_usage() > memory_limit && arena.get_num_of_cells() > cells_after_collection + cells_after_collection / 2;
+}
+
+void HashLife_Table::mark(Macrocell_Ref cell, std::vector<bool>& marks) const
+{
+	std::size_t slot = find_slot(hash(cell->nw, cell->ne, cell->se, cell->sw), cell->nw, cell->ne, cell->se, cell->sw);
+	if(slot == marks.size() || marks[slot])
+		return;
+
+	marks[slot] = true;
+	// leaves have no daughter cells (nw and ne are used as cell states)
+	if(cell->is_leaf())
+		return;
+
+	mark(cell->nw, marks);
+	mark(cell->ne, marks);
+	mark(cell->se, marks);
+	mark(cell->sw, marks);
+	Macrocell_Ref result = cell->get_result();
+	if(result)
+		mark(result, marks);
 }
 
-void HashLife_Table::clear_results(std::size_t level)
+std::size_t HashLife_Table::collect_garbage(const std::vector<Macrocell_Ref>& roots)
 {
-	for(std::size_t i = 0; i < data.size(); ++i)
+	auto begin = std::chrono::steady_clock::now();
+
+	finish_resize();
+	Slot_Array* array = current.load(std::memory_order_relaxed);
+
+	// mark all reachable cells
+	std::vector<bool> marks(array->size, false);
+	for(const auto& a : roots)
+		if(a)
+			mark(a, marks);
+	for(const auto& a : empty_cells)
+		if(a)
+			mark(a, marks);
+
+	// cached results are kept only if their cells are reachable
+	rebuild_result_cache(result_cache_size, &marks);
+
+	// sweep unmarked cells
+	std::size_t reclaimed = 0;
+	for(std::size_t i = 0; i < array->size; ++i)
 	{
-		// skip empty slots
-		if(!is_empty_slot(data_pos[i]))
-			// clear all results (alternative: calc level of each cell using Macrocell::level() -> more expensive)
-//			clear_result(data[i].second, empty_cells.size(), level);
-			clear_result(data[i].second, data[i].second->level(), level);
+		if(array->ctrl(i).load(std::memory_order_relaxed) >= reserved_ctrl || marks[i])
+			continue;
+
+		arena.release(array->slots[i].cell);
+		array->ctrl(i).store(empty_ctrl, std::memory_order_relaxed);
+		++reclaimed;
 	}
+
+	// shrink slots if they are mostly empty and reinsert remaining cells; removed slots would break the probe sequences otherwise
+	std::size_t num_of_elements = array->num_of_elements.load(std::memory_order_relaxed) - reclaimed;
+	std::size_t new_size = array->size;
+	while(new_size > initial_size && num_of_elements < max_load_factor * new_size / 4)
+		new_size >>= 1;
+	rebuild(new_size);
+
+	cells_after_collection = arena.get_num_of_cells();
+	++num_of_collections;
+	last_collection_time = static_cast<std::size_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count());
+	last_reclaimed = reclaimed * sizeof(Macrocell);
+
+	return last_reclaimed;
 }
 
 void HashLife_Table::set_rule_set(std::size_t survival_rules, std::size_t rebirth_rules)
@@ -118,195 +311,416 @@ void HashLife_Table::set_rule_set(std::size_t survival_rules, std::size_t rebirt
 	clear();
 }
 
-Macrocell* HashLife_Table::operator[](const Macrocell* key) const
+Macrocell_Ref HashLife_Table::operator[](Macrocell_Ref key)
 {
 	return get(key->nw, key->ne, key->se, key->sw);
 }
 
-Macrocell* HashLife_Table::get(const Macrocell* nw, const Macrocell* ne, const Macrocell* se, const Macrocell* sw) const
+Macrocell_Ref HashLife_Table::get(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
 {
-	std::size_t hash_value = hash(nw, ne, se, sw);
-	const std::size_t max_size = (data_pos.size() - 1);
-	std::size_t num = hash_value & max_size;
+	const std::size_t hash_value = hash(nw, ne, se, sw);
+	const uint8_t tag = get_tag(hash_value);
+	Slot_Array* array = current.load(std::memory_order_acquire);
 
-	std::size_t distance = 0;
-	bool search_enabled = false;
 	while(true)
 	{
-		if(is_empty_slot(data_pos[num]))
-			return nullptr;
-		else
+		const std::size_t max_group = array->size / group_size - 1;
+		std::size_t group = get_group(hash_value, array);
+		while(true)
 		{
-			if(distance == data_pos[num])
+			Group_Match match = match_group(array->groups[group], tag);
+			for(uint32_t candidates = match.published | match.reserved; candidates != 0; candidates &= candidates - 1)
+			{
+				std::size_t num = group * group_size + count_trailing_zeros(candidates);
+				wait_for_slot(array->ctrl(num));
+				if(is_match(array->slots[num], nw, ne, se, sw))
+					return array->slots[num].cell;
+			}
+
+			// the first free slot ends the probe sequence
+			if(match.free != 0)
 			{
-				search_enabled = true;
-				if(data[num].first == hash_value)
-				{
-					if(data[num].second->nw == nw &&
-							data[num].second->ne == ne &&
-							data[num].second->se == se &&
-							data[num].second->sw == sw)
-						return data[num].second;
-				}
+				if(array->ctrl(group * group_size + count_trailing_zeros(match.free)).load(std::memory_order_acquire) != moved_ctrl)
+					return nullptr;
+				break;
 			}
-			else if(search_enabled)
-				return nullptr;
 
-			distance = (distance + 1) & max_size;
-			num = (num + 1) & max_size;
+			group = (group + 1) & max_group;
 		}
+
+		// the slot array is replaced; continue in successor
+		array = array->successor.load(std::memory_order_acquire);
 	}
 }
 
-void HashLife_Table::insert(const Macrocell* key, Macrocell* value)
+void HashLife_Table::prefetch_group(std::size_t hash_value) const
 {
-	insert(key->nw, key->ne, key->se, key->sw, value);
+#if defined(__SSE2__) && !defined(__SANITIZE_THREAD__)
+	const Slot_Array* array = current.load(std::memory_order_acquire);
+	_mm_prefetch(reinterpret_cast<const char*>(&array->groups[get_group(hash_value, array)]), _MM_HINT_T0);
+#else
+	static_cast<void>(hash_value);
+#endif
 }
 
-void HashLife_Table::insert(const Macrocell* nw, const Macrocell* ne, const Macrocell* se, const Macrocell* sw, Macrocell* value)
+void HashLife_Table::prefetch_slot(std::size_t hash_value) const
 {
-	if(++num_of_elements > max_load_factor * data.size())
-		internal_resize(data.size() << 1);
-
-	std::size_t hash_value = hash(nw, ne, se, sw);
-	const std::size_t max_size = (data_pos.size() - 1);
-	std::size_t num = hash_value & max_size;
+#if defined(__SSE2__) && !defined(__SANITIZE_THREAD__)
+	const Slot_Array* array = current.load(std::memory_order_acquire);
+	const std::size_t group = get_group(hash_value, array);
+	// the cell is usually the first candidate; if there is none, the cell is created in a free slot of this group
+	const Group_Match match = match_group(array->groups[group], get_tag(hash_value));
+	const uint32_t candidates = (match.published) ? match.published : match.free;
+	if(candidates)
+		_mm_prefetch(reinterpret_cast<const char*>(&array->slots[group * group_size + count_trailing_zeros(candidates)]), _MM_HINT_T0);
+#else
+	static_cast<void>(hash_value);
+#endif
+}
 
-	uint8_t distance = 0;
-	while(true)
+void HashLife_Table::find_or_create(std::size_t count, const Macrocell_Ref (*daughters)[4], Macrocell_Ref* cells)
+{
+	std::size_t hash_values[max_batch_size];
+	for(std::size_t begin = 0; begin < count; begin += max_batch_size)
 	{
-		if(is_empty_slot(data_pos[num]))
+		const std::size_t num = std::min(count - begin, max_batch_size);
+		const Macrocell_Ref (*batch)[4] = daughters + begin;
+
+		// each stage starts the loads of all cells before the next stage waits for the first one
+		for(std::size_t i = 0; i < num; ++i)
 		{
-			data_pos[num] = distance;
-			data[num].first = hash_value;
-			data[num].second = value;
-			return;
+			hash_values[i] = hash(batch[i][0], batch[i][1], batch[i][2], batch[i][3]);
+			prefetch_group(hash_values[i]);
 		}
-		else
+		for(std::size_t i = 0; i < num; ++i)
+			prefetch_slot(hash_values[i]);
+		for(std::size_t i = 0; i < num; ++i)
+			cells[begin + i] = find_or_create(hash_values[i], batch[i][0], batch[i][1], batch[i][2], batch[i][3]);
+	}
+}
+
+Macrocell_Ref HashLife_Table::find_or_create(std::size_t hash_value, Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
+{
+	const uint8_t tag = get_tag(hash_value);
+	Slot_Array* array = current.load(std::memory_order_acquire);
+	// each call migrates a bounded part of a running resize, so no call waits for the whole migration
+	if(array->successor.load(std::memory_order_acquire) != nullptr)
+		migrate_chunk(array);
+
+	while(true)
+	{
+		const std::size_t max_group = array->size / group_size - 1;
+		std::size_t group = get_group(hash_value, array);
+		while(true)
 		{
-			if(distance > data_pos[num])
+			// all candidates are checked, because the reserving thread may create the searched cell
+			Group_Match match = match_group(array->groups[group], tag);
+			for(uint32_t candidates = match.published | match.reserved; candidates != 0; candidates &= candidates - 1)
 			{
-				std::swap(distance, data_pos[num]);
-				std::swap(hash_value, data[num].first);
-				std::swap(value, data[num].second);
-				distance = 0;
-				num = hash_value & max_size;
+				std::size_t num = group * group_size + count_trailing_zeros(candidates);
+				wait_for_slot(array->ctrl(num));
+				if(is_match(array->slots[num], nw, ne, se, sw))
+					return array->slots[num].cell;
 			}
 
-			distance = (distance + 1) & max_size;
-			num = (num + 1) & max_size;
+			if(match.free == 0)
+			{
+				group = (group + 1) & max_group;
+				continue;
+			}
+
+			// a cell is always inserted into the first free slot of its probe sequence; if it is moved, the cell can only be in successor
+			// during a resize, new cells are inserted into successor; the free slot is sealed, so other threads looking for the cell continue in successor, too
+			std::size_t num = group * group_size + count_trailing_zeros(match.free);
+			uint8_t ctrl = empty_ctrl;
+			if(array->successor.load(std::memory_order_acquire) != nullptr)
+			{
+				if(array->ctrl(num).compare_exchange_strong(ctrl, moved_ctrl, std::memory_order_acq_rel) || ctrl == moved_ctrl)
+					break;
+			}
+			else if(array->ctrl(num).compare_exchange_strong(ctrl, tag | reserved_ctrl, std::memory_order_acq_rel))
+			{
+				// publish new cell; waiting threads read the slot after the control byte
+				Macrocell_Ref cell = create_cell(nw, ne, se, sw);
+				new(&array->slots[num]) Slot{ nw, ne, se, sw, cell };
+				array->ctrl(num).store(tag, std::memory_order_release);
+
+				if(array->num_of_elements.fetch_add(1, std::memory_order_relaxed) + 1 > max_load_factor * array->size)
+					start_resize(array);
+
+				return cell;
+			}
+			else if(ctrl == moved_ctrl)
+				break;
+			// another thread claimed the slot meanwhile; check the group again
 		}
+
+		array = array->successor.load(std::memory_order_acquire);
 	}
 }
 
-void HashLife_Table::fill_hash_table()
+HashLife_Table::Group_Match HashLife_Table::match_group(const Group& group, uint8_t tag)
 {
-	insert(dead_cell, dead_cell);
-	insert(alive_cell, alive_cell);
-	empty_cells[0] = dead_cell;
-
-	std::array<Macrocell*, 16> first_level_cells;
-	for(unsigned short a = 0; a < 2; ++a)
-		for(unsigned short b = 0; b < 2; ++b)
-			for(unsigned short c = 0; c < 2; ++c)
-				for(unsigned short d = 0; d < 2; ++d)
-				{
-					Macrocell* temp = new Macrocell((a) ? alive_cell : dead_cell,
-													(b) ? alive_cell : dead_cell,
-													(c) ? alive_cell : dead_cell,
-													(d) ? alive_cell : dead_cell);
-					insert(temp, temp);
-					first_level_cells[8 * a + 4 * b + 2 * c + d] = temp;
-
-					if(!a && !b && !c && !d)
-						empty_cells[1] = temp;
-				}
-
-	for(const auto& a : first_level_cells)
-		for(const auto& b : first_level_cells)
-			for(const auto& c : first_level_cells)
-				for(const auto& d : first_level_cells)
-				{
-					Macrocell* temp = new Macrocell(a, b, c, d);
-					insert(temp, temp);
-					temp->result = get_second_level_result(temp);
-					if(temp->population == 0)
-						empty_cells[2] = temp;
-				}
-}
-
-void HashLife_Table::internal_resize(std::size_t new_size)
-{
-	decltype(data) temp_data(new_size);
-	std::fill(data_pos.begin(), data_pos.end(), 0xFF);
-	data_pos.resize(new_size, 0xFF);
-
-	const std::size_t max_size = (new_size - 1);
-
-	for(auto& a : data)
+	Group_Match match;
+#if defined(__SSE2__) && !defined(__SANITIZE_THREAD__)
+	// all control bytes are loaded at once; a candidate is confirmed by an atomic load of its control byte
+	const __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(group.ctrl));
+	match.published = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(tag)))));
+	match.reserved = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(tag | reserved_ctrl)))));
+	match.free = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(moved_ctrl))),
+																	   _mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(empty_ctrl))))));
+#else
+	match = Group_Match{ 0, 0, 0 };
+	for(std::size_t i = 0; i < group_size; ++i)
 	{
-		// skip empty entries
-		if(a.second == nullptr)
-			continue;
+		uint8_t ctrl = group.ctrl[i].load(std::memory_order_relaxed);
+		if(ctrl == tag)
+			match.published |= 1u << i;
+		else if(ctrl == (tag | reserved_ctrl))
+			match.reserved |= 1u << i;
+		else if(ctrl >= moved_ctrl)
+			match.free |= 1u << i;
+	}
+#endif
+	return match;
+}
 
-		std::size_t num = a.first & max_size;
+uint8_t HashLife_Table::wait_for_slot(const std::atomic<uint8_t>& ctrl)
+{
+	while(true)
+	{
+		uint8_t value = ctrl.load(std::memory_order_acquire);
+		if(value == empty_ctrl || value == moved_ctrl || (value & reserved_ctrl) == 0)
+			return value;
 
-		uint8_t distance = 0;
-		while(true)
+		std::this_thread::yield();
+	}
+}
+
+std::size_t HashLife_Table::find_slot(std::size_t hash_value, Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw) const
+{
+	const Slot_Array* array = current.load(std::memory_order_relaxed);
+	const uint8_t tag = get_tag(hash_value);
+	const std::size_t max_group = array->size / group_size - 1;
+
+	for(std::size_t group = get_group(hash_value, array); ; group = (group + 1) & max_group)
+	{
+		Group_Match match = match_group(array->groups[group], tag);
+		for(uint32_t candidates = match.published; candidates != 0; candidates &= candidates - 1)
 		{
-			if(is_empty_slot(data_pos[num]))
-			{
-				data_pos[num] = distance;
-				temp_data[num].first = a.first;
-				temp_data[num].second = a.second;
-				break;
-			}
-			else
-			{
-				if(distance > data_pos[num])
-				{
-					std::swap(distance, data_pos[num]);
-					a.swap(temp_data[num]);
-					distance = 0;
-					num = a.first & max_size;
-				}
-
-				++distance;
-				num = (num + 1) & max_size;
-			}
+			std::size_t num = group * group_size + count_trailing_zeros(candidates);
+			if(is_match(array->slots[num], nw, ne, se, sw))
+				return num;
+		}
+
+		if(match.free != 0)
+			return array->size;
+	}
+}
+
+Macrocell_Ref HashLife_Table::create_cell(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
+{
+	// if there are more threads than areas, an area is shared, so it is locked
+	const std::size_t area = current_area(num_of_areas);
+
+	if(!concurrent)
+		return arena.create(area, nw, ne, se, sw);
+
+	while(area_locks[area].test_and_set(std::memory_order_acquire))
+		std::this_thread::yield();
+	Macrocell_Ref cell = arena.create(area, nw, ne, se, sw);
+	area_locks[area].clear(std::memory_order_release);
+
+	return cell;
+}
+
+void HashLife_Table::start_resize(Slot_Array* array)
+{
+	std::lock_guard<std::mutex> lock(resize_mutex);
+	// a successor is only appended to the current slot array, so at most one resize is running
+	if(array != current.load(std::memory_order_acquire) || array->successor.load(std::memory_order_acquire) != nullptr)
+		return;
+
+	// previously replaced slot arrays cannot be read by other threads
+	if(!concurrent)
+		release_replaced();
+
+	slot_arrays.emplace_back(new Slot_Array(array->size << 1));
+	array->successor.store(slot_arrays.back().get(), std::memory_order_release);
+}
+
+void HashLife_Table::migrate_chunk(Slot_Array* array)
+{
+	Slot_Array* successor = array->successor.load(std::memory_order_acquire);
+
+	std::size_t begin = array->next_chunk.fetch_add(migration_chunk, std::memory_order_relaxed);
+	if(begin < array->size)
+	{
+		const std::size_t end = std::min(begin + migration_chunk, array->size);
+		for(std::size_t i = begin; i < end; ++i)
+		{
+			std::atomic<uint8_t>& ctrl = array->ctrl(i);
+			uint8_t value = ctrl.load(std::memory_order_acquire);
+
+			// seal empty slots, so no cell can be inserted after migration; threads reaching a sealed slot continue in successor
+			while(value == empty_ctrl && !ctrl.compare_exchange_weak(value, moved_ctrl, std::memory_order_acq_rel))
+				;
+			// slots may also be sealed by insertions during the resize
+			if(value == empty_ctrl || value == moved_ctrl)
+				continue;
+
+			wait_for_slot(ctrl);
+			insert_migrated(successor, array->slots[i]);
+		}
+
+		// the thread which migrates the last chunk replaces the slot array
+		if(array->num_of_migrated.fetch_add(end - begin, std::memory_order_acq_rel) + (end - begin) == array->size)
+			current.store(successor, std::memory_order_release);
+	}
+}
+
+void HashLife_Table::insert_migrated(Slot_Array* array, const Slot& slot)
+{
+	const std::size_t hash_value = hash(slot.nw, slot.ne, slot.se, slot.sw);
+	const uint8_t tag = get_tag(hash_value);
+	const std::size_t max_group = array->size / group_size - 1;
+	std::size_t group = get_group(hash_value, array);
+
+	while(true)
+	{
+		// the cell is not in successor yet, so only the free slots are of interest
+		uint32_t free = match_group(array->groups[group], tag).free;
+		if(free == 0)
+		{
+			group = (group + 1) & max_group;
+			continue;
+		}
+
+		std::size_t num = group * group_size + count_trailing_zeros(free);
+		uint8_t ctrl = empty_ctrl;
+		if(array->ctrl(num).compare_exchange_strong(ctrl, tag | reserved_ctrl, std::memory_order_acq_rel))
+		{
+			new(&array->slots[num]) Slot(slot);
+			array->ctrl(num).store(tag, std::memory_order_release);
+			array->num_of_elements.fetch_add(1, std::memory_order_relaxed);
+			return;
 		}
 	}
+}
+
+void HashLife_Table::rebuild(std::size_t new_size)
+{
+	Slot_Array* array = current.load(std::memory_order_relaxed);
+	std::unique_ptr<Slot_Array> new_array(new Slot_Array(new_size));
+	for(std::size_t i = 0; i < array->size; ++i)
+		if(array->ctrl(i).load(std::memory_order_relaxed) < reserved_ctrl)
+			insert_migrated(new_array.get(), array->slots[i]);
+
+	slot_arrays.clear();
+	slot_arrays.emplace_back(std::move(new_array));
+	current = slot_arrays.back().get();
+}
 
-	data = std::move(temp_data);
+void HashLife_Table::release_replaced()
+{
+	Slot_Array* array = current.load(std::memory_order_relaxed);
+	slot_arrays.erase(std::remove_if(slot_arrays.begin(), slot_arrays.end(),
+									 [array] (const std::unique_ptr<Slot_Array>& a) { return a.get() != array && a.get() != array->successor.load(std::memory_order_relaxed); }),
+					  slot_arrays.end());
 }
 
-Macrocell* HashLife_Table::get_second_level_result(Macrocell* second_level)
+void HashLife_Table::finish_resize()
 {
-	Macrocell* result_cells[4];
-	for(std::size_t cell = 0; cell < 4; ++cell)
+	Slot_Array* array = current.load(std::memory_order_acquire);
+	while(array->successor.load(std::memory_order_acquire) != nullptr)
 	{
-		std::size_t alive_neighbors = 0;
-		for(std::size_t y = 0 + ((cell & 0x02) >> 1); y < 3 + ((cell & 0x02) >> 1); ++y)
-			for(std::size_t x = 0 + (cell & 0x01); x < 3 + (cell & 0x01); ++x)
-				alive_neighbors += second_level->get_state(x, y, 2);
-
-		bool self = second_level->get_state(1 + (cell & 0x01), 1 + ((cell & 0x02) >> 1), 2);
-		alive_neighbors -= self;
-		// if cell is alive, try survival_rules
-		if(self)
+		migrate_chunk(array);
+		array = current.load(std::memory_order_acquire);
+	}
+
+	release_replaced();
+}
+
+void HashLife_Table::synchronize()
+{
+	// a running resize is continued by later insertions
+	release_replaced();
+
+	if(num_of_cached_results.load(std::memory_order_relaxed) > result_cache_size / 2)
+		rebuild_result_cache(result_cache_size << 1, nullptr);
+}
+
+void HashLife_Table::fill_hash_table()
+{
+	empty_cells[Macrocell::leaf_level] = find_or_create(nullptr, nullptr, nullptr, nullptr);
+}
+
+// add mask to the neighbor counts of all columns; the counts are stored in bit planes (count = s0 + 2 * s1 + 4 * s2 + 8 * s3)
+static inline void add_neighbors(uint32_t mask, uint32_t& s0, uint32_t& s1, uint32_t& s2, uint32_t& s3)
+{
+	uint32_t carry0 = s0 & mask;
+	s0 ^= mask;
+	uint32_t carry1 = s1 & carry0;
+	s1 ^= carry0;
+	uint32_t carry2 = s2 & carry1;
+	s2 ^= carry1;
+	s3 |= carry2;
+}
+
+Macrocell_Ref HashLife_Table::calculate_leaves(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw, std::size_t generations)
+{
+	// one row of 16 cells per element; bit x is column x
+	uint32_t rows[16];
+	uint64_t nw_bits = nw->get_bits(), ne_bits = ne->get_bits(), se_bits = se->get_bits(), sw_bits = sw->get_bits();
+	for(std::size_t y = 0; y < 8; ++y)
+	{
+		rows[y] = ((nw_bits >> (y * 8)) & 0xFF) | (((ne_bits >> (y * 8)) & 0xFF) << 8);
+		rows[y + 8] = ((sw_bits >> (y * 8)) & 0xFF) | (((se_bits >> (y * 8)) & 0xFF) << 8);
+	}
+
+	// the valid area shrinks by one cell per generation at each side
+	for(std::size_t gen = 1; gen <= generations; ++gen)
+	{
+		uint32_t next[16];
+		for(std::size_t y = gen; y < 16 - gen; ++y)
 		{
-			if(survival_rules & (1 << alive_neighbors))
-				result_cells[cell] = alive_cell;
-			else
-				result_cells[cell] = dead_cell;
+			const uint32_t above = rows[y - 1], self = rows[y], below = rows[y + 1];
+			uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+			add_neighbors(above << 1, s0, s1, s2, s3);
+			add_neighbors(above, s0, s1, s2, s3);
+			add_neighbors(above >> 1, s0, s1, s2, s3);
+			add_neighbors(self << 1, s0, s1, s2, s3);
+			add_neighbors(self >> 1, s0, s1, s2, s3);
+			add_neighbors(below << 1, s0, s1, s2, s3);
+			add_neighbors(below, s0, s1, s2, s3);
+			add_neighbors(below >> 1, s0, s1, s2, s3);
+
+			// apply rules to all columns with matching neighbor count
+			uint32_t new_row = 0;
+			for(std::size_t n = 0; n < 9; ++n)
+			{
+				const bool survive = survival_rules & (1 << n);
+				const bool rebirth = rebirth_rules & (1 << n);
+				if(!survive && !rebirth)
+					continue;
+
+				uint32_t count_mask = ((n & 1) ? s0 : ~s0) & ((n & 2) ? s1 : ~s1) & ((n & 4) ? s2 : ~s2) & ((n & 8) ? s3 : ~s3);
+				if(survive)
+					new_row |= count_mask & self;
+				if(rebirth)
+					new_row |= count_mask & ~self;
+			}
+			next[y] = new_row & 0xFFFF;
 		}
-		// if cell is dead, try rebirth_rules
-		else if(rebirth_rules & (1 << alive_neighbors))
-			result_cells[cell] = alive_cell;
-		else
-			result_cells[cell] = dead_cell;
+
+		for(std::size_t y = gen; y < 16 - gen; ++y)
+			rows[y] = next[y];
 	}
 
-	// requires level 1 macrocells in table
-	return get(result_cells[0], result_cells[1], result_cells[3], result_cells[2]);
+	// center 8x8 cells
+	uint64_t bits = 0;
+	for(std::size_t y = 0; y < 8; ++y)
+		bits |= static_cast<uint64_t>((rows[y + 4] >> 4) & 0xFF) << (y * 8);
+
+	return Macrocell::new_leaf(bits);
 }
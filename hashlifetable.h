@@ -3,95 +3,244 @@
 #ifndef HASHLIFETABLE_H
 #define HASHLIFETABLE_H
 
+#include "hashlifearena.h"
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 struct Macrocell;
 
-// hash table which stores all macrocells using robin hood hashing
+/* lock-free hash table which stores handles of all macrocells; the slots are probed in groups of 16 (like a swiss table)
+ * each slot has a control byte containing a 7-bit tag of the hash value; the control bytes of a group are compared at once (SSE2 or scalar fallback)
+ * the daughter cells are stored in the slot next to the handle, so a lookup does not read the macrocell
+ * a thread which creates a macrocell reserves the first free slot of the probe sequence by compare-and-swap of the control byte and publishes it afterwards;
+ * threads looking for the same daughter cells wait for the publication, so each combination of daughter cells exists only once although several threads create macrocells at the same time
+ * if the table is too full, a twice as large slot array is appended; each insertion migrates one chunk of slots until the old slot array is empty (incremental resize)
+ * meanwhile both slot arrays are used: lookups continue in the new one at moved slots and new cells are inserted into the new one */
 class HashLife_Table
 {
-	// store pointers to all created empty cells
-	std::vector<Macrocell*> empty_cells;
-	// pointers to the two states of a zero level cell
-	Macrocell* alive_cell;
-	Macrocell* dead_cell;
-	// currently precalculated state in 2^precalced_gens_exp generations
-	std::size_t precalced_gens_exp;
+	// num of areas of arena (power of two); each thread creates its macrocells in an own area
+	static constexpr std::size_t num_of_areas = 64;
+	// num of slots per group
+	static constexpr std::size_t group_size = 16;
+	// initial num of slots
+	static constexpr std::size_t initial_size = 1 << 17;
+	// num of slots migrated by each insertion during resizing (multiple of group_size); this bounds the extra work of an insertion
+	static constexpr std::size_t migration_chunk = 1 << 5;
+
+	// owner of all macrocells
+	Macrocell_Arena arena;
+	// store handles to all created empty cells; the index is the level (there are no cells below leaf level)
+	std::vector<Macrocell_Ref> empty_cells;
 	// currently active rule set
 	std::size_t survival_rules;
 	std::size_t rebirth_rules;
 
-	// fill hash table with macrocells up to the second level (with results)
+	// insert empty leaf into hash table
 	void fill_hash_table();
-	// return next macrocell state of given second_level macrocell
-	Macrocell* get_second_level_result(Macrocell* second_level);
 
-	// clear down to last_level
-	void clear_result(Macrocell* cell, std::size_t level, std::size_t last_level);
+	// control bytes: tag (0 - 125) of a published slot, tag | reserved_ctrl of a claimed slot whose cell is not published yet,
+	// empty_ctrl or moved_ctrl (slot was empty when it was migrated; continue in successor)
+	static constexpr uint8_t reserved_ctrl = 0x80;
+	static constexpr uint8_t moved_ctrl = 0xFE;
+	static constexpr uint8_t empty_ctrl = 0xFF;
 
-	inline bool is_empty_slot(uint8_t num) const { return (num == 0xFF); }
-	// state of slots; describes distance to the actual slot (determined by hash value); 0xFF describes an empty slot
-	std::vector<uint8_t> data_pos;
-	// slots in which the hash values and the pointer are stored; the hash are the combined pointers of the daughter macrocells
-	std::vector< std::pair<uint64_t, Macrocell*> > data;
-	// amount of occupied slots
-	std::size_t num_of_elements;
+	struct alignas(group_size) Group
+	{
+		std::atomic<uint8_t> ctrl[group_size];
+	};
+	struct Slot
+	{
+		Macrocell_Ref nw, ne, se, sw;
+		Macrocell_Ref cell;
+	};
+	// control bytes of a group matching a tag; bit i is set if slot i matches
+	struct Group_Match
+	{
+		uint32_t published;
+		uint32_t reserved;
+		uint32_t free;							// empty or moved
+	};
+
+	struct Slot_Array
+	{
+		std::size_t size;
+		std::unique_ptr<Group[]> groups;
+		// uninitialized memory, so allocating a large slot array does not touch all of it; a slot is constructed when it is claimed
+		Slot* slots;
+		// amount of occupied slots
+		std::atomic<std::size_t> num_of_elements;
+		// larger slot array which replaces this one; nullptr if no resize is running
+		std::atomic<Slot_Array*> successor;
+		// first slot which is not claimed for migration yet and num of migrated slots
+		std::atomic<std::size_t> next_chunk;
+		std::atomic<std::size_t> num_of_migrated;
+
+		Slot_Array(std::size_t size);
+		~Slot_Array();
+
+		inline std::atomic<uint8_t>& ctrl(std::size_t slot) { return groups[slot / group_size].ctrl[slot % group_size]; }
+	};
+	// current slot array; lookups start here and follow successors during a resize
+	std::atomic<Slot_Array*> current;
+	// all slot arrays including replaced ones, which may still be read by other threads; replaced ones are freed by release_replaced()
+	std::vector<std::unique_ptr<Slot_Array>> slot_arrays;
+	std::mutex resize_mutex;
+	// if false, no other thread uses the table and the areas of arena are not locked
+	bool concurrent;
+	std::atomic_flag area_locks[num_of_areas];
+
+	// return tag (upper 7 bits) of given hash value and first group of its probe sequence (lower bits)
+	static inline uint8_t get_tag(std::size_t hash_value) { uint8_t tag = hash_value >> (sizeof(std::size_t) * 8 - 7); return (tag < 0x7E) ? tag : tag - 0x7E; }
+	static inline std::size_t get_group(std::size_t hash_value, const Slot_Array* array) { return hash_value & (array->size / group_size - 1); }
+	// compare all control bytes of given group with given tag
+	static Group_Match match_group(const Group& group, uint8_t tag);
+	// return published control byte of given slot; wait while it is reserved
+	static uint8_t wait_for_slot(const std::atomic<uint8_t>& ctrl);
+	// return true if given slot contains given daughter cells; the slot has to be published
+	static inline bool is_match(const Slot& slot, Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
+	{
+		return slot.nw == nw && slot.ne == ne && slot.se == se && slot.sw == sw;
+	}
 
-	// if num_of_elements / data.size() is greater than 0.5,
-	static constexpr double max_load_factor = 0.5;
-	// size of slots is doubled including rehashing
-	void internal_resize(std::size_t new_size);
+	// max num of cells whose slots are prefetched at once by find_or_create() of several cells
+	static constexpr std::size_t max_batch_size = 16;
+	// return cell matching given daughter cells with given hash value; if there is no match, a new cell is created and inserted (thread-safe)
+	Macrocell_Ref find_or_create(std::size_t hash_value, Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw);
+	// prefetch control bytes of the first group of the probe sequence of given hash value
+	void prefetch_group(std::size_t hash_value) const;
+	// prefetch first slot of the first group of the probe sequence whose tag matches given hash value; the control bytes should be prefetched before
+	void prefetch_slot(std::size_t hash_value) const;
+
+	// return index of slot of cell matching given daughter cells in current slot array; return size of slot array if there is no match (single-threaded only)
+	std::size_t find_slot(std::size_t hash_value, Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw) const;
+	// create macrocell in the area of the calling thread
+	Macrocell_Ref create_cell(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw);
+	// mark slot of given cell, its daughter cells and its result recursively
+	void mark(Macrocell_Ref cell, std::vector<bool>& marks) const;
+
+	// num of results of Macrocell::calculate() which were found (hits) or calculated (misses); each area has own counters, so threads do not share a cache line
+	struct alignas(64) Result_Counter
+	{
+		std::atomic<std::size_t> hits;
+		std::atomic<std::size_t> misses;
+	};
+	Result_Counter result_counters[num_of_areas];
+
+	// num of macrocells after last garbage collection
+	std::size_t cells_after_collection;
+	// statistics of garbage collection
+	std::size_t num_of_collections;
+	std::size_t last_collection_time;		// µs
+	std::size_t last_reclaimed;				// bytes
+
+	// results which were replaced in their macrocell by the result of another exponent; filled by cache_result()
+	struct Cached_Result
+	{
+		std::atomic<uint64_t> key;				// index of macrocell (upper 32 bit) and exponent + 1; 0 marks an empty entry
+		std::atomic<uint32_t> result;			// index of result; 0 if it is not written yet
+	};
+	static constexpr std::size_t initial_result_cache_size = 1 << 12;
+	std::unique_ptr<Cached_Result[]> result_cache;
+	std::size_t result_cache_size;
+	std::atomic<std::size_t> num_of_cached_results;
+	// return first entry of probe sequence of given key
+	inline std::size_t cache_position(uint64_t key) const { return ((key * 0x9E3779B97F4A7C15ull) >> 32) & (result_cache_size - 1); }
+	// replace result cache by one of given size containing all entries whose cell and result are marked (single-threaded only)
+	void rebuild_result_cache(std::size_t new_size, const std::vector<bool>* marks);
+
+	// if num_of_elements / size of the slot array is greater than 0.875, a resize is started
+	static constexpr double max_load_factor = 0.875;
+	// append successor with twice the size to given slot array (if no other thread did it before); its slots are migrated by later insertions
+	void start_resize(Slot_Array* array);
+	// migrate next chunk of given slot array which is not claimed by another thread; the thread migrating the last chunk replaces the slot array
+	void migrate_chunk(Slot_Array* array);
+	// migrate all remaining slots and free replaced slot arrays (single-threaded only)
+	void finish_resize();
+	// copy published slot into successor during migration
+	static void insert_migrated(Slot_Array* array, const Slot& slot);
+	// replace all slot arrays by one new slot array of given size containing all handles of current one (single-threaded only)
+	void rebuild(std::size_t new_size);
+	// free replaced slot arrays (single-threaded only)
+	void release_replaced();
 
 public:
-	// init hash table and fill it with level 0-2 cells
+	// init hash table and insert empty leaf
 	HashLife_Table();
-	// delete all macrocells
-	~HashLife_Table();
+	// all macrocells are released by arena
+	~HashLife_Table() = default;
+
+	HashLife_Table(const HashLife_Table&) = delete;
+	HashLife_Table& operator=(const HashLife_Table&) = delete;
 
 	// hash pointers of daughter macrocells to one hash value
-	static std::size_t hash(const Macrocell* macrocell);
-	static std::size_t hash(const Macrocell* nw, const Macrocell* ne, const Macrocell* se, const Macrocell* sw);
+	static std::size_t hash(Macrocell_Ref macrocell);
+	static std::size_t hash(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw);
 
 	// set current level to create empty_cells; if new_level is smaller than any previous set value, the function has no effect
 	void set_level(std::size_t new_level);
-	// delete all inserted macrocells and fill it with new level 0-2 macrocells
+	// release all inserted macrocells and insert new empty leaf
 	void clear();
 
-	// clear results of macrocells down to given level
-	void clear_results(std::size_t level);
+	// return result of 2^exp generations of given cell which was replaced in the cell; return nullptr if it is not cached (thread-safe)
+	Macrocell_Ref get_cached_result(Macrocell_Ref cell, std::size_t exp) const;
+	// keep replaced result of 2^exp generations of given cell; it is dropped if the cache is full (thread-safe)
+	void cache_result(Macrocell_Ref cell, std::size_t exp, Macrocell_Ref result);
+
+	// release all macrocells which are not reachable from given roots or empty cells; results of reachable cells are kept
+	// no other macrocell pointers may be used afterwards, so this must not be called during a calculation; return num of reclaimed bytes
+	std::size_t collect_garbage(const std::vector<Macrocell_Ref>& roots);
+	// return true if memory usage exceeds given limit (bytes) and enough cells were created since last collection
+	bool needs_collection(std::size_t memory_limit) const;
 
 	// apply new rules; this causes a deletion of all inserted cells
 	void set_rule_set(std::size_t survival_rules, std::size_t rebirth_rules);
 
 	// return cell matching nw, ne, se and sw members of key; return nullptr if there is no match
-	Macrocell* operator[](const Macrocell* key) const;
-	// return cell matching given daughter cells; return nullptr if there is no match
-	Macrocell* get(const Macrocell* nw, const Macrocell* ne, const Macrocell* se, const Macrocell* sw) const;
+	Macrocell_Ref operator[](Macrocell_Ref key);
+	// return cell matching given daughter cells; return nullptr if there is no match (thread-safe)
+	Macrocell_Ref get(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw);
+	// return cell matching given daughter cells; if there is no match, a new cell is created and inserted (thread-safe)
+	inline Macrocell_Ref find_or_create(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw) { return find_or_create(hash(nw, ne, se, sw), nw, ne, se, sw); }
+	// store cells matching given daughter cells (nw, ne, se, sw) of count entries in cells; missing cells are created and inserted (thread-safe)
+	// the control bytes and then the matching slots of all cells are prefetched before the first cell is looked up, so their cache misses overlap instead of following each other
+	void find_or_create(std::size_t count, const Macrocell_Ref (*daughters)[4], Macrocell_Ref* cells);
 
 	// check if given macrocell is in stored in hash table
-	inline bool count(const Macrocell* key) const
+	inline bool count(Macrocell_Ref key)
 	{
 		return (this->operator[](key) != nullptr);
 	}
-	inline bool count(const Macrocell* nw, const Macrocell* ne, const Macrocell* se, const Macrocell* sw) const
+	inline bool count(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw)
 	{
 		return (get(nw, ne, se, sw) != nullptr);
 	}
 
-	// insert new macrocell into hash table; value has to be != nullptr
-	void insert(const Macrocell* key, Macrocell* value);
-	void insert(const Macrocell* nw, const Macrocell* ne, const Macrocell* se, const Macrocell* sw, Macrocell* value);
+	// return center leaf of the 16x16 cells given by four leaves after given num of generations (1 - 4); the cells are calculated by bit-parallel logic
+	Macrocell_Ref calculate_leaves(Macrocell_Ref nw, Macrocell_Ref ne, Macrocell_Ref se, Macrocell_Ref sw, std::size_t generations);
+
+	// count result of Macrocell::calculate() which was found in memory (hit) or calculated (miss); counts of threads sharing an area may be lost (thread-safe)
+	void count_result(bool hit);
+	// return num of counted hits and misses since construction
+	void get_result_counts(std::size_t& hits, std::size_t& misses) const;
 
-	// set exponent (power of two) of currently precalculated generations stored in the results
-	inline void set_precalced_exp(std::size_t new_precalced_exp) { precalced_gens_exp = new_precalced_exp; }
+	// enable locking of arena; has to be enabled before several threads use the table
+	inline void set_concurrent(bool enable) { concurrent = enable; }
+	// free replaced slot arrays and grow result cache; must not be called while other threads use the table
+	void synchronize();
 
 // get members
-	inline Macrocell* get_empty(std::size_t level) const { return empty_cells[level]; }
-	inline Macrocell* get_alive() const { return alive_cell; }
-	inline Macrocell* get_dead() const { return dead_cell; }
-	inline std::size_t get_precalced_exp() const{ return precalced_gens_exp; }
-	inline std::size_t get_precalced() const{ return 0x01ull << precalced_gens_exp; }
+	inline Macrocell* get_cell(uint32_t index) const { return arena.get(index); }
+	inline Macrocell_Ref get_empty(std::size_t level) const { return empty_cells[level]; }
+	inline std::size_t get_survival_rules() const { return survival_rules; }
+	inline std::size_t get_rebirth_rules() const { return rebirth_rules; }
+	// return bytes used by stored macrocells and slots
+	std::size_t get_memory_usage() const;
+	inline std::size_t get_num_of_collections() const { return num_of_collections; }
+	inline std::size_t get_last_collection_time() const { return last_collection_time; }
+	inline std::size_t get_last_reclaimed() const { return last_reclaimed; }
 };
 
 #endif // HASHLIFETABLE_H
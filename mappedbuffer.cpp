@@ -0,0 +1,140 @@
+// © Copyright (c) 2018 SqYtCO
+
+#include "mappedbuffer.h"
+
+#ifdef ENABLE_MEMORY_MAPPING
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Mapped_Buffer::Mapped_Buffer() : address(nullptr), size(0), file_descriptor(-1)
+{	}
+
+Mapped_Buffer::~Mapped_Buffer()
+{
+	close();
+}
+
+#ifdef ENABLE_MEMORY_MAPPING
+bool Mapped_Buffer::create(const std::string& file, std::size_t size)
+{
+	close();
+
+	// the file is created under a temporary name and renamed afterwards; an existing file is not truncated, so a mapping of it (e.g. the current game) keeps its contents
+	const std::string temp_file = file + ".tmp";
+	file_descriptor = ::open(temp_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(file_descriptor < 0)
+		return false;
+
+	// allocate file; the new file contains only zeros (dead cells) and may be sparse
+	void* temp = MAP_FAILED;
+	if(ftruncate(file_descriptor, static_cast<off_t>(size)) == 0)
+		temp = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+	if(temp == MAP_FAILED || std::rename(temp_file.c_str(), file.c_str()) != 0)
+	{
+		if(temp != MAP_FAILED)
+			munmap(temp, size);
+		close();
+		unlink(temp_file.c_str());
+		return false;
+	}
+
+	address = static_cast<char*>(temp);
+	this->size = size;
+	return true;
+}
+
+bool Mapped_Buffer::open(const std::string& file)
+{
+	close();
+
+	file_descriptor = ::open(file.c_str(), O_RDWR);
+	if(file_descriptor < 0)
+		return false;
+
+	struct stat file_stat;
+	if(fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size <= 0)
+	{
+		close();
+		return false;
+	}
+
+	void* temp = mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+	if(temp == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+
+	address = static_cast<char*>(temp);
+	size = static_cast<std::size_t>(file_stat.st_size);
+	return true;
+}
+
+void Mapped_Buffer::close()
+{
+	if(address)
+		munmap(address, size);
+	if(file_descriptor >= 0)
+		::close(file_descriptor);
+
+	address = nullptr;
+	size = 0;
+	file_descriptor = -1;
+}
+
+bool Mapped_Buffer::page_range(std::size_t& offset, std::size_t& length) const
+{
+	static const std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+	if(address == nullptr || offset >= size || length == 0)
+		return false;
+
+	// madvise() requires a page aligned address
+	length += offset % page_size;
+	offset -= offset % page_size;
+	if(offset + length > size)
+		length = size - offset;
+
+	return true;
+}
+
+void Mapped_Buffer::advise_sequential() const
+{
+	if(address)
+		madvise(address, size, MADV_SEQUENTIAL);
+}
+
+void Mapped_Buffer::advise_will_need(std::size_t offset, std::size_t length) const
+{
+	if(page_range(offset, length))
+		madvise(address + offset, length, MADV_WILLNEED);
+}
+
+void Mapped_Buffer::advise_dont_need(std::size_t offset, std::size_t length) const
+{
+	if(page_range(offset, length))
+		madvise(address + offset, length, MADV_DONTNEED);
+}
+
+bool Mapped_Buffer::sync() const
+{
+	if(address == nullptr)
+		return false;
+
+	return msync(address, size, MS_SYNC) == 0;
+}
+#else
+// memory mapping is not supported: every attempt to map a file fails
+bool Mapped_Buffer::create(const std::string&, std::size_t) { return false; }
+bool Mapped_Buffer::open(const std::string&) { return false; }
+void Mapped_Buffer::close() {	}
+bool Mapped_Buffer::page_range(std::size_t&, std::size_t&) const { return false; }
+void Mapped_Buffer::advise_sequential() const {	}
+void Mapped_Buffer::advise_will_need(std::size_t, std::size_t) const {	}
+void Mapped_Buffer::advise_dont_need(std::size_t, std::size_t) const {	}
+bool Mapped_Buffer::sync() const { return false; }
+#endif // ENABLE_MEMORY_MAPPING
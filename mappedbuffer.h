@@ -0,0 +1,55 @@
+// © Copyright (c) 2018 SqYtCO
+
+#ifndef MAPPEDBUFFER_H
+#define MAPPEDBUFFER_H
+
+#include <cstddef>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ENABLE_MEMORY_MAPPING
+#endif
+
+// file-backed memory mapping which is used to store cells which exceed the physical memory
+// the kernel loads and writes back the pages on demand; the advise functions allow to stream the file sequentially
+// if memory mapping is not supported on the platform (ENABLE_MEMORY_MAPPING is not defined), create() and open() always fail
+class Mapped_Buffer
+{
+	char* address;							// begin of mapping; nullptr if nothing is mapped
+	std::size_t size;						// size of mapping in bytes
+	int file_descriptor;					// descriptor of mapped file; -1 if nothing is mapped
+
+	// round down given offset to page boundary and extend given length accordingly; return false if range is empty
+	bool page_range(std::size_t& offset, std::size_t& length) const;
+
+public:
+	Mapped_Buffer();
+	// unmap and close file; changes are written back by the kernel
+	~Mapped_Buffer();
+
+	Mapped_Buffer(const Mapped_Buffer&) = delete;
+	Mapped_Buffer& operator=(const Mapped_Buffer&) = delete;
+
+	// create given file with given size and map it; an existing file is replaced (not truncated), so other mappings of it are not changed; return true on success
+	bool create(const std::string& file, std::size_t size);
+	// map existing file with its current size; return true on success
+	bool open(const std::string& file);
+	// unmap and close file
+	void close();
+
+	// tell the kernel that the whole mapping is accessed sequentially
+	void advise_sequential() const;
+	// tell the kernel that the given range will be accessed soon (read ahead)
+	void advise_will_need(std::size_t offset, std::size_t length) const;
+	// tell the kernel that the given range is not needed anymore (pages can be released; dirty pages are kept in the page cache)
+	void advise_dont_need(std::size_t offset, std::size_t length) const;
+	// write back all changes to the file; return true on success
+	bool sync() const;
+
+// get members
+	inline char* data() const { return address; }
+	inline std::size_t get_size() const { return size; }
+	inline bool is_mapped() const { return address != nullptr; }
+};
+
+#endif // MAPPEDBUFFER_H
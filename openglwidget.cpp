@@ -3,15 +3,17 @@
 #include "openglwidget.h"
 #include "core.h"
 #include "graphiccore.h"
+#include "hashlifesystem.h"
 #include <QKeyEvent>
 #include <mutex>
 #include <cmath>
+#include <algorithm>
 #ifdef ENABLE_DRAW_TIME_MEASUREMENT
 #include <QDebug>
 #include <chrono>
 #endif
 
-OpenGLWidget::OpenGLWidget(QWidget* parent) : QOpenGLWidget(parent), cell_size(GraphicCore::get_config()->get_cell_size()), move_x(0), move_y(0)
+OpenGLWidget::OpenGLWidget(QWidget* parent) : QOpenGLWidget(parent), cell_size(GraphicCore::get_config()->get_cell_size()), cell_shift(0), move_x(0), move_y(0)
 {
 	// if update has to be done from other thread
 	QObject::connect(this, &OpenGLWidget::start_update, this, &OpenGLWidget::full_update);
@@ -59,7 +61,11 @@ void OpenGLWidget::wheelEvent(QWheelEvent* event)
 	{
 		double factor = (1 + (event->angleDelta().y() / 360. * 0.3 /* = zoom-speed factor */));
 		factor = (factor <= 0) ? 0.1 : factor;
-		if(static_cast<std::size_t>(cell_size * factor) <= 1)
+		if(factor < 1 && cell_size == 1)
+			zoom_out_subpixel();
+		else if(factor > 1 && cell_shift > 0)
+			zoom_in_subpixel();
+		else if(static_cast<std::size_t>(cell_size * factor) <= 1)
 			cell_size = 1;
 		else if(static_cast<std::size_t>(cell_size * factor) == cell_size)
 		{
@@ -83,6 +89,27 @@ void OpenGLWidget::wheelEvent(QWheelEvent* event)
 	update();
 }
 
+void OpenGLWidget::zoom_out_subpixel()
+{
+	if(cell_shift == max_cell_shift || Core::get_hashlife_system() == nullptr)
+		return;
+
+	++cell_shift;
+	// keep cells in the center of the view
+	move_x /= 2;
+	move_y /= 2;
+}
+
+void OpenGLWidget::zoom_in_subpixel()
+{
+	if(cell_shift == 0)
+		return;
+
+	--cell_shift;
+	move_x *= 2;
+	move_y *= 2;
+}
+
 void OpenGLWidget::mousePressEvent(QMouseEvent* event)
 {
 	mouse_pressed = true;
@@ -130,7 +157,8 @@ void OpenGLWidget::mouseReleaseEvent(QMouseEvent*)
 
 void OpenGLWidget::mouseMoveEvent(QMouseEvent* event)
 {
-	if(mouse_pressed)
+	// cells cannot be set below 1px
+	if(mouse_pressed && cell_shift == 0)
 	{
 		int dif_x = previous_pos.x() - event->pos().x();
 		int dif_y = previous_pos.y() - event->pos().y();
@@ -239,14 +267,18 @@ void OpenGLWidget::keyPressEvent(QKeyEvent* event)
 	// zoom: [+/-]
 	else if(event->key() == Qt::Key_Plus)
 	{
-		if(cell_size <= 10)
+		if(cell_shift > 0)
+			zoom_in_subpixel();
+		else if(cell_size <= 10)
 			++cell_size;
 		else if(cell_size < 8 * GraphicCore::get_config()->get_cell_size())
 			cell_size *= 1.25;
 	}
 	else if(event->key() == Qt::Key_Minus)
 	{
-		if(cell_size <= 10 && cell_size > 1)
+		if(cell_size == 1)
+			zoom_out_subpixel();
+		else if(cell_size <= 10)
 			--cell_size;
 		else if(cell_size > 1)
 			cell_size *= 0.8;
@@ -261,6 +293,13 @@ void OpenGLWidget::keyPressEvent(QKeyEvent* event)
 		// avoid double repainting
 		return;
 	}
+	// previous generation: backspace
+	else if(event->key() == Qt::Key_Backspace)
+	{
+		GraphicCore::previous_generation();
+		// avoid double repainting
+		return;
+	}
 	// start/stop autogenerating: r
 	else if(event->key() == Qt::Key_R)
 	{
@@ -328,16 +367,24 @@ void OpenGLWidget::paintGL()
 	// set 0/0 to top-left-corner
 	glOrtho(0, width(), height(), 0, -1, 1);
 
+	// only HashLife can be drawn below 1px; the movement is scaled like zoom_in_subpixel(), so the cells in the center of the view are kept
+	if(cell_shift > 0 && Core::get_hashlife_system() == nullptr)
+	{
+		move_x *= static_cast<big_signed>(0x01ull << cell_shift);
+		move_y *= static_cast<big_signed>(0x01ull << cell_shift);
+		cell_shift = 0;
+	}
+
 	// set null_pos central (moved by move_x/move_y and scaled by scale-factor)
-	null_pos_x = move_x + (width() / 2) - static_cast<big_signed>((Core::get_size_x() / 2) * cell_size);
-	null_pos_y = move_y + (height() / 2) - static_cast<big_signed>((Core::get_size_y() / 2) * cell_size);
+	null_pos_x = move_x + (width() / 2) - to_pixels(Core::get_size_x() / 2);
+	null_pos_y = move_y + (height() / 2) - to_pixels(Core::get_size_y() / 2);
 
 	// expand if borders are visible
 	while(Core::get_config()->get_border_behavior() == Border_Behavior::Borderless &&
 			// check right border
-			((null_pos_x + static_cast<big_signed>(Core::get_size_x() * cell_size) - width()) <= 0 ||
+			((null_pos_x + to_pixels(Core::get_size_x()) - width()) <= 0 ||
 			// check lower border
-			 (null_pos_y + static_cast<big_signed>(Core::get_size_y() * cell_size) - height()) <= 0 ||
+			 (null_pos_y + to_pixels(Core::get_size_y()) - height()) <= 0 ||
 			// check left and upper borders
 			 (null_pos_x) > 0 || (null_pos_y) > 0))
 	{
@@ -345,8 +392,8 @@ void OpenGLWidget::paintGL()
 		if(!Core::expand())
 				break;
 		// update current null_pos
-		null_pos_x = move_x + (width() / 2) - static_cast<big_signed>((Core::get_size_x() / 2) * cell_size);
-		null_pos_y = move_y + (height() / 2) - static_cast<big_signed>((Core::get_size_y() / 2) * cell_size);
+		null_pos_x = move_x + (width() / 2) - to_pixels(Core::get_size_x() / 2);
+		null_pos_y = move_y + (height() / 2) - to_pixels(Core::get_size_y() / 2);
 		emit new_system_created();
 	}
 
@@ -368,10 +415,10 @@ void OpenGLWidget::paintGL()
 void OpenGLWidget::draw_cells()
 {
 	// calc visible cells
-	std::size_t x_begin = static_cast<std::size_t>(-1 * null_pos_x) / cell_size;
-	std::size_t y_begin = static_cast<std::size_t>(-1 * null_pos_y) / cell_size;
-	std::size_t x_end = x_begin + static_cast<std::size_t>(width()) / cell_size + 3;
-	std::size_t y_end = y_begin + static_cast<std::size_t>(height()) / cell_size + 3;
+	std::size_t x_begin = (null_pos_x < 0) ? (static_cast<std::size_t>(-1 * null_pos_x) << cell_shift) / cell_size : 0;
+	std::size_t y_begin = (null_pos_y < 0) ? (static_cast<std::size_t>(-1 * null_pos_y) << cell_shift) / cell_size : 0;
+	std::size_t x_end = x_begin + ((static_cast<std::size_t>(width()) / cell_size + 3) << cell_shift);
+	std::size_t y_end = y_begin + ((static_cast<std::size_t>(height()) / cell_size + 3) << cell_shift);
 
 	// check boundaries
 	if(x_begin > Core::get_size_x())
@@ -388,8 +435,8 @@ void OpenGLWidget::draw_cells()
 			   static_cast<GLubyte>(GraphicCore::get_config()->get_dead_color().green()),
 			   static_cast<GLubyte>(GraphicCore::get_config()->get_dead_color().blue()));
 
-	big_signed graphic_size_x = static_cast<big_signed>(Core::get_size_x() * cell_size);
-	big_signed graphic_size_y = static_cast<big_signed>(Core::get_size_y() * cell_size);
+	big_signed graphic_size_x = to_pixels(Core::get_size_x());
+	big_signed graphic_size_y = to_pixels(Core::get_size_y());
 
 	// if field is out of sight, don't draw any cell
 	if(null_pos_x > (width() + graphic_size_x) || null_pos_x < (-1 * graphic_size_x) ||
@@ -414,22 +461,42 @@ void OpenGLWidget::draw_cells()
 			glRecti(real_null_pos_x, real_null_pos_y, width(), height());
 	}
 
+	// HashLife below 1px: each pixel shows a block of cells
+	const HashLife_System* hashlife = Core::get_hashlife_system();
+	if(hashlife && cell_shift > 0)
+	{
+		draw_macrocell_blocks(hashlife, x_begin, y_begin, x_end, y_end, real_null_pos_x, real_null_pos_y);
+		return;
+	}
+
+	// read states of all visible cells at once; next states are only used if autogenerating is not running
+	const bool generating = GraphicCore::generating_running();
+	const std::size_t columns = x_end - x_begin;
+	visible_states.resize(columns * (y_end - y_begin));
+	next_visible_states.resize(visible_states.size());
+	// HashLife calculates the next states of the visible cells only; they are kept until the view or the cells change
+	if(hashlife && !generating && !visible_states.empty())
+		Core::calc_next_states(x_begin, y_begin, columns, y_end - y_begin, GraphicCore::get_config()->get_generations_per_step());
+	Core::get_cell_states(x_begin, y_begin, columns, y_end - y_begin, visible_states.data(), (generating) ? nullptr : next_visible_states.data());
+
 	GLint x1 = real_null_pos_x, y1 = real_null_pos_y, x2, y2;
 	// draw line by line visible cells
 	for(std::size_t a = y_begin; a < y_end; ++a)
 	{
 		// y-coord of right lower corner
 		y2 = static_cast<GLint>((a - y_begin + 1) * cell_size) + real_null_pos_y;
+		const Cell_State* current_row = visible_states.data() + (a - y_begin) * columns;
+		const Cell_State* next_row = next_visible_states.data() + (a - y_begin) * columns;
 
 		for(std::size_t b = x_begin; b < x_end; ++b)
 		{
 			x2 = static_cast<GLint>((b - x_begin + 1) * cell_size) + real_null_pos_x;
 
 			// alive cells
-			if(Core::get_cell_state(b, a))
+			if(current_row[b - x_begin])
 			{
 				// if autogenerating is running, use only alive color
-				if(GraphicCore::generating_running() || Core::get_next_cell_state(b, a))
+				if(generating || next_row[b - x_begin])
 					// alive cell color
 					glColor3ub(static_cast<GLubyte>(GraphicCore::get_config()->get_alive_color().red()),
 							   static_cast<GLubyte>(GraphicCore::get_config()->get_alive_color().green()),
@@ -443,7 +510,7 @@ void OpenGLWidget::draw_cells()
 				glRecti(x1, y1, x2, y2);
 			}
 			// dead but in next generation reviving cells; use only if autogenerating is not running
-			else if(!GraphicCore::generating_running() && Core::get_next_cell_state(b, a))
+			else if(!generating && next_row[b - x_begin])
 			{
 				// reviving cell color
 				glColor3ub(static_cast<GLubyte>(GraphicCore::get_config()->get_reviving_color().red()),
@@ -461,9 +528,31 @@ void OpenGLWidget::draw_cells()
 	}
 }
 
+void OpenGLWidget::draw_macrocell_blocks(const HashLife_System* system, std::size_t x_begin, std::size_t y_begin, std::size_t x_end, std::size_t y_end, int null_x, int null_y)
+{
+	const QColor& alive = GraphicCore::get_config()->get_alive_color();
+	const QColor& dead = GraphicCore::get_config()->get_dead_color();
+
+	// without expanded field a block may be smaller than a pixel; several blocks are drawn to the same pixel then
+	const std::size_t block_level = std::min(cell_shift, system->get_level() - 2);
+	const double block_cells = static_cast<double>(0x01ull << (2 * block_level));
+	system->for_each_block(x_begin, y_begin, x_end, y_end, block_level, [&] (std::size_t x, std::size_t y, std::size_t population)
+	{
+		// the color is mixed of dead and alive color by the density of living cells, but a block with living cells stays visible
+		double ratio = 0.25 + 0.75 * (population / block_cells);
+		glColor3ub(static_cast<GLubyte>(dead.red() + ratio * (alive.red() - dead.red())),
+				   static_cast<GLubyte>(dead.green() + ratio * (alive.green() - dead.green())),
+				   static_cast<GLubyte>(dead.blue() + ratio * (alive.blue() - dead.blue())));
+		GLint pos_x = null_x + static_cast<GLint>((x - x_begin) >> cell_shift);
+		GLint pos_y = null_y + static_cast<GLint>((y - y_begin) >> cell_shift);
+		glRecti(pos_x, pos_y, pos_x + 1, pos_y + 1);
+	});
+}
+
 void OpenGLWidget::draw_grid()
 {
-	if(GraphicCore::get_config()->get_grid_active())
+	// no grid below 1px
+	if(GraphicCore::get_config()->get_grid_active() && cell_shift == 0)
 	{
 		// actual null position
 		GLint real_null_pos_x = (null_pos_x < 0) ? (null_pos_x % static_cast<GLint>(cell_size)) : (null_pos_x > width()) ? width() : static_cast<GLint>(null_pos_x);
@@ -505,6 +594,7 @@ void OpenGLWidget::reset_movement()
 	move_x = 0;
 	move_y = 0;
 	cell_size = GraphicCore::get_config()->get_cell_size();
+	cell_shift = 0;
 
 	update();
 }
@@ -3,10 +3,15 @@
 #ifndef OPENGLWIDGET_H
 #define OPENGLWIDGET_H
 
+#include "basesystem.h"
 #include <QOpenGLWidget>
 #include <QTimer>
 #include <thread>
 #include <atomic>
+#include <limits>
+#include <vector>
+
+class HashLife_System;
 
 // widget of game view
 // this widget draws the cells and start calculation and generating
@@ -22,6 +27,9 @@ class OpenGLWidget : public QOpenGLWidget
 
 	// cell size in px; must be >0
 	std::size_t cell_size;
+	// zoom below 1px (HashLife only): a pixel shows 2^cell_shift x 2^cell_shift cells; cell_size is 1 if it is >0
+	std::size_t cell_shift;
+	static constexpr std::size_t max_cell_shift = 24;
 
 	// move state in px
 	big_signed move_x;
@@ -39,6 +47,22 @@ class OpenGLWidget : public QOpenGLWidget
 
 	std::unique_ptr<std::thread> calc_thread;
 
+	// current and next states of visible cells; kept to avoid an allocation per frame
+	std::vector<Cell_State> visible_states;
+	std::vector<Cell_State> next_visible_states;
+
+	// largest num of px of to_pixels(); sums of positions in px do not overflow
+	static constexpr big_signed max_pixels = std::numeric_limits<big_signed>::max() >> 2;
+	// return num of px of given num of cells; cells are shifted first (cell_size is 1 then) and the product is limited to max_pixels, because HashLife fields exceed the range of px
+	inline big_signed to_pixels(std::size_t cells) const
+	{
+		cells >>= cell_shift;
+		return (cells > static_cast<std::size_t>(max_pixels) / cell_size) ? max_pixels : static_cast<big_signed>(cells * cell_size);
+	}
+	// halve/double num of px per cell below 1px (cell_shift); zooming out below 1px is only supported by HashLife
+	void zoom_out_subpixel();
+	void zoom_in_subpixel();
+
 public:
 	// init member and connect generating_timer
 	OpenGLWidget(QWidget* parent = nullptr);
@@ -65,6 +89,8 @@ protected:
 	virtual void paintGL() override;
 	// draw cells using OpenGL
 	void draw_cells();
+	// draw HashLife below 1px; each pixel is a block of cells shaded by the density of its living cells
+	void draw_macrocell_blocks(const HashLife_System* system, std::size_t x_begin, std::size_t y_begin, std::size_t x_end, std::size_t y_end, int null_x, int null_y);
 	// draw (if enabled) grid using OpenGL
 	void draw_grid();
 
@@ -253,6 +253,9 @@ void PreferencesWidget::init_game_group()
 	// connect lock cells checkbox
 	QObject::connect(&lock_cells_after_generation_zero_check, &QCheckBox::clicked,
 					 [](bool state) { GraphicCore::get_config()->set_lock_after_first_generating(state); });
+	// connect hyperspeed checkbox
+	QObject::connect(&hyperspeed_check, &QCheckBox::clicked,
+					 [](bool state) { GraphicCore::get_config()->set_hyperspeed(state); });
 
 	// add components to group layout
 	game_layout.addWidget(&size_x_text, 0, 0);
@@ -273,6 +276,7 @@ void PreferencesWidget::init_game_group()
 	game_layout.addWidget(&rebirth_rules_text, 9, 0, 1, 3);
 	game_layout.addLayout(rebirth_rules_layout, 10, 0, 1, 3);
 	game_layout.addWidget(&lock_cells_after_generation_zero_check, 11, 0, 1, 3, Qt::AlignVCenter);
+	game_layout.addWidget(&hyperspeed_check, 12, 0, 1, 3, Qt::AlignVCenter);
 
 	// set group layout
 	game_group.setLayout(&game_layout);
@@ -286,6 +290,12 @@ void PreferencesWidget::init_application_group()
 	QObject::connect(&num_of_threads_input, &QSpinBox::editingFinished,
 					 [this]() { Core::get_config()->set_num_of_threads(static_cast<std::size_t>(num_of_threads_input.value())); restart_required = true; });
 
+	// init number of used processes input; set maximum to number of supported concurrent threads
+	num_of_processes_input.setMinimum(1);
+	num_of_processes_input.setMaximum(static_cast<int>(std::thread::hardware_concurrency()));
+	QObject::connect(&num_of_processes_input, &QSpinBox::editingFinished,
+					 [this]() { Core::get_config()->set_num_of_processes(static_cast<std::size_t>(num_of_processes_input.value())); restart_required = true; });
+
 	// connect fullscreen checkbox
 	QObject::connect(&start_fullscreen, &QCheckBox::clicked,
 					 [](bool state) { GraphicCore::get_config()->set_fullscreen(state); });
@@ -338,12 +348,14 @@ void PreferencesWidget::init_application_group()
 
 	application_layout.addWidget(&num_of_threads_text, 0, 0);
 	application_layout.addWidget(&num_of_threads_input, 0, 1);
-	application_layout.addWidget(&start_fullscreen, 1, 0, 1, 3);
-	application_layout.addWidget(&show_exit_warning_check, 2, 0, 1, 3);
-	application_layout.addWidget(&save_path_text, 3, 0);
-	application_layout.addWidget(&save_path_input, 3, 1);
-	application_layout.addWidget(&save_path_browse, 3, 2);
-	application_layout.addWidget(&show_saved_games_dir, 4, 1, 1, 2);
+	application_layout.addWidget(&num_of_processes_text, 1, 0);
+	application_layout.addWidget(&num_of_processes_input, 1, 1);
+	application_layout.addWidget(&start_fullscreen, 2, 0, 1, 3);
+	application_layout.addWidget(&show_exit_warning_check, 3, 0, 1, 3);
+	application_layout.addWidget(&save_path_text, 4, 0);
+	application_layout.addWidget(&save_path_input, 4, 1);
+	application_layout.addWidget(&save_path_browse, 4, 2);
+	application_layout.addWidget(&show_saved_games_dir, 5, 1, 1, 2);
 
 	application_group.setLayout(&application_layout);
 }
@@ -486,6 +498,7 @@ void PreferencesWidget::reload_game()
 	}
 	delay_between_generations_input.setValue(static_cast<int>(GraphicCore::get_config()->get_delay()));
 	lock_cells_after_generation_zero_check.setChecked(GraphicCore::get_config()->get_lock_after_first_generating());
+	hyperspeed_check.setChecked(GraphicCore::get_config()->get_hyperspeed());
 }
 
 void PreferencesWidget::reload_appearance()
@@ -504,6 +517,7 @@ void PreferencesWidget::reload_application()
 	show_exit_warning_check.setChecked(GraphicCore::get_config()->get_exit_warning());
 	start_fullscreen.setChecked(GraphicCore::get_config()->get_fullscreen());
 	num_of_threads_input.setValue(static_cast<int>(Core::get_config()->get_num_of_threads()));
+	num_of_processes_input.setValue(static_cast<int>(Core::get_config()->get_num_of_processes()));
 	// only default path is relative
 	if(GraphicCore::get_config()->get_save_path().empty() || QDir(GraphicCore::get_config()->get_save_path().c_str()).isRelative() || GraphicCore::get_config()->get_save_path() == Default_Values::SAVE_PATH)
 		// set path relative to current path
@@ -588,6 +602,7 @@ void PreferencesWidget::translate()
 	survival_rules_text.setText(tr("Number Of Neighbors Which Are Needed To Survive"));
 	rebirth_rules_text.setText(tr("Number Of Neighbors Which Are Needed To Be Born"));
 	lock_cells_after_generation_zero_check.setText(tr("Lock Cells After Initial Generation"));
+	hyperspeed_check.setText(tr("Hyperspeed (Borderless Games)"));
 	// tooltips
 	size_x_text.setToolTip(tr("Width:"));
 	size_x_unit.setToolTip(tr("Cells"));
@@ -606,6 +621,7 @@ void PreferencesWidget::translate()
 	survival_rules_text.setToolTip(tr("Number Of Neighbors Which Are Needed To Survive"));
 	rebirth_rules_text.setToolTip(tr("Number Of Neighbors Which Are Needed To Be Born"));
 	lock_cells_after_generation_zero_check.setToolTip(tr("Lock Cells After Initial Generation"));
+	hyperspeed_check.setToolTip(tr("Increase Generations Per Frame While The Pattern Repeats Itself"));
 
 	// application: texts
 	application_group.setTitle(tr("Application"));
@@ -613,12 +629,14 @@ void PreferencesWidget::translate()
 	show_exit_warning_check.setText(tr("Show Exit Warning"));
 	start_fullscreen.setText(tr("Start In Fullscreen Mode"));
 	num_of_threads_text.setText(tr("Number Of Threads Used For Calculation"));
+	num_of_processes_text.setText(tr("Number Of Processes Used For Bounded Games"));
 	save_path_text.setText(tr("Default Path Of Saved Games"));
 	// tooltips
 	show_saved_games_dir.setToolTip(tr("Show Saved Game Directory"));
 	show_exit_warning_check.setToolTip(tr("Show Exit Warning"));
 	start_fullscreen.setToolTip(tr("Start In Fullscreen Mode"));
 	num_of_threads_text.setToolTip(tr("Number Of Threads Used For Calculation"));
+	num_of_processes_text.setToolTip(tr("Number Of Processes Used For Bounded Games"));
 	save_path_text.setToolTip(tr("Default Path Of Saved Games"));
 }
 
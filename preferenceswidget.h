@@ -167,12 +167,15 @@ private:
 	QLabel rebirth_rules_text;
 	std::array<RuleButton*, 9> rebirth_rules_input;
 	QCheckBox lock_cells_after_generation_zero_check;
+	QCheckBox hyperspeed_check;
 
 	// application preferences
 	QGroupBox application_group;
 	QGridLayout application_layout;
 	QLabel num_of_threads_text;
 	QSpinBox num_of_threads_input;
+	QLabel num_of_processes_text;
+	QSpinBox num_of_processes_input;
 	QCheckBox start_fullscreen;
 	QCheckBox show_exit_warning_check;
 	QLabel save_path_text;
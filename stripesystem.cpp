@@ -0,0 +1,230 @@
+// © Copyright (c) 2018 SqYtCO
+
+#include "stripesystem.h"
+#include <algorithm>
+#include <random>
+#ifdef ENABLE_SHARED_MEMORY_TRANSPORT
+#include <unistd.h>					// _exit()
+#endif
+
+Stripe_System::Stripe_System(std::size_t columns, std::size_t rows, const Border_Behavior& border_behavior,
+			std::size_t survival_rules, std::size_t rebirth_rules, std::size_t processes) : Base_System(columns, rows), valid(false), current_system(0),
+																							survival_rules(survival_rules), rebirth_rules(rebirth_rules),
+																							border_behavior(border_behavior)
+{
+	// at least one row per stripe
+	num_of_ranks = std::max<std::size_t>(1, std::min(processes, rows));
+
+	// distribute rows; the first (rows % num_of_ranks) stripes get one additional row
+	first_rows.resize(num_of_ranks + 1);
+	for(std::size_t rank = 0; rank <= num_of_ranks; ++rank)
+		first_rows[rank] = rank * (rows / num_of_ranks) + std::min(rank, rows % num_of_ranks);
+	stripe_capacity = rows / num_of_ranks + ((rows % num_of_ranks) ? 1 : 0);
+
+#ifdef ENABLE_SHARED_MEMORY_TRANSPORT
+	auto shm_transport = new Shared_Memory_Transport(num_of_ranks, columns, 2 * (stripe_capacity + 2) * columns,
+													 border_behavior == Border_Behavior::Continue_On_Opposite_Side);
+	transport.reset(shm_transport);
+	if(!shm_transport->is_valid())
+		return;
+#else
+	return;
+#endif
+
+	// set halo rows of outer stripes to state of border; they are never overwritten because the transport is not periodic
+	Cell_State border_state = static_cast<Cell_State>(border_behavior == Border_Behavior::Surrounded_By_Living_Cells);
+	for(std::size_t state = 0; state < 2; ++state)
+	{
+		std::fill_n(get_row(0, state, 0), size_x, border_state);
+		std::fill_n(get_row(num_of_ranks - 1, state, first_rows[num_of_ranks] - first_rows[num_of_ranks - 1] + 1), size_x, border_state);
+	}
+
+	std::size_t rank = transport->launch();
+	if(rank >= num_of_ranks)
+		return;
+
+#ifdef ENABLE_SHARED_MEMORY_TRANSPORT
+	// worker process: execute commands and terminate without returning to the caller
+	if(rank != 0)
+	{
+		worker_loop(rank);
+		_exit(0);
+	}
+#endif
+
+	valid = true;
+
+	// set all cells to dead
+	set_all(Dead);
+}
+
+Stripe_System::~Stripe_System()
+{
+	if(!transport)
+		return;
+
+	// workers of an abandoned transport are terminated by join()
+	if(valid)
+		transport->send_command(Stripe_Command::Exit_Stripe, 0);
+	transport->join();
+}
+
+std::size_t Stripe_System::get_rank(std::size_t y) const
+{
+	// first stripe whose first row is greater than y, minus one
+	return static_cast<std::size_t>(std::upper_bound(first_rows.begin(), first_rows.end(), y) - first_rows.begin()) - 1;
+}
+
+bool Stripe_System::calc_stripe(std::size_t rank)
+{
+	std::size_t rows = first_rows[rank + 1] - first_rows[rank];
+
+	// receive current border rows of neighbor stripes
+	if(!transport->exchange_halos(rank, get_row(rank, current_system, 1), get_row(rank, current_system, rows),
+								  get_row(rank, current_system, 0), get_row(rank, current_system, rows + 1)))
+		return false;
+
+	Cell_State border_state = static_cast<Cell_State>(border_behavior == Border_Behavior::Surrounded_By_Living_Cells);
+	bool periodic = (border_behavior == Border_Behavior::Continue_On_Opposite_Side);
+
+	for(std::size_t row = 1; row <= rows; ++row)
+	{
+		const Cell_State* upper = get_row(rank, current_system, row - 1);
+		const Cell_State* middle = get_row(rank, current_system, row);
+		const Cell_State* lower = get_row(rank, current_system, row + 1);
+		Cell_State* next = get_row(rank, current_system ^ 0x01, row);
+
+		for(std::size_t x = 0; x < size_x; ++x)
+		{
+			std::size_t alive_neighbors = static_cast<std::size_t>(upper[x]) + static_cast<std::size_t>(lower[x]);
+
+			// left neighbors
+			if(x > 0)
+				alive_neighbors += static_cast<std::size_t>(upper[x - 1] + middle[x - 1] + lower[x - 1]);
+			else if(periodic)
+				alive_neighbors += static_cast<std::size_t>(upper[size_x - 1] + middle[size_x - 1] + lower[size_x - 1]);
+			else
+				alive_neighbors += 3 * static_cast<std::size_t>(border_state);
+
+			// right neighbors
+			if(x < size_x - 1)
+				alive_neighbors += static_cast<std::size_t>(upper[x + 1] + middle[x + 1] + lower[x + 1]);
+			else if(periodic)
+				alive_neighbors += static_cast<std::size_t>(upper[0] + middle[0] + lower[0]);
+			else
+				alive_neighbors += 3 * static_cast<std::size_t>(border_state);
+
+			// if cell is alive, try survival_rules; if cell is dead, try rebirth_rules
+			if(middle[x])
+				next[x] = (survival_rules & (1 << alive_neighbors)) ? Alive : Dead;
+			else
+				next[x] = (rebirth_rules & (1 << alive_neighbors)) ? Alive : Dead;
+		}
+	}
+
+	return true;
+}
+
+bool Stripe_System::execute_calc(std::size_t rank, std::size_t generations, std::size_t& advanced)
+{
+	advanced = 0;
+
+	// only calculate next state of current generation
+	if(generations == 0)
+		return calc_stripe(rank);
+
+	for(; advanced < generations; ++advanced)
+	{
+		// update state to next_state: change system to next generation (precalculated)
+		current_system ^= 0x01;
+		// calculate new next_state
+		if(!calc_stripe(rank))
+		{
+			// the halos of this generation were not exchanged, so other stripes may not have reached it; the previous state is kept by all stripes
+			current_system ^= 0x01;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Stripe_System::worker_loop(std::size_t rank)
+{
+	std::size_t argument, advanced;
+	while(true)
+	{
+		Stripe_Command command = transport->receive_command(argument);
+
+		if(command == Stripe_Command::Exit_Stripe)
+			return;
+		else if(command == Stripe_Command::Calc_Stripe && !execute_calc(rank, argument, advanced))
+			return;
+
+		if(!transport->finish_command())
+			return;
+	}
+}
+
+void Stripe_System::calc_next_generation()
+{
+	next_generation(0);
+}
+
+void Stripe_System::next_generation()
+{
+	next_generation(1);
+}
+
+std::size_t Stripe_System::next_generation(std::size_t generations)
+{
+	// a terminated worker can not calculate its stripe anymore
+	if(!valid)
+		return 0;
+
+	std::size_t advanced = 0;
+	valid = transport->send_command(Stripe_Command::Calc_Stripe, generations) && execute_calc(0, generations, advanced) && transport->finish_command();
+	return advanced;
+}
+
+void Stripe_System::random_cells(std::size_t alive, std::size_t dead)
+{
+	// initialize random generation; generate values between 0 and ("alive" + "dead") for right ratio
+	std::random_device rd;
+	std::mt19937 mt(rd());
+	std::uniform_int_distribution<std::size_t> dist(0, alive + dead - 1);
+
+	for(std::size_t row = 0; row < size_y; ++row)
+		for(std::size_t column = 0; column < size_x; ++column)
+			// if generated random value is lower than "alive", the cell lifes (ratio: "alive"/"dead")
+			set_cell(column, row, static_cast<Cell_State>(dist(mt) < alive));
+
+	calc_next_generation();
+}
+
+void Stripe_System::set_cell(std::size_t x, std::size_t y, Cell_State state)
+{
+	std::size_t rank = get_rank(y);
+	get_row(rank, current_system, y - first_rows[rank] + 1)[x] = state;
+	get_row(rank, current_system ^ 0x01, y - first_rows[rank] + 1)[x] = state;
+}
+
+void Stripe_System::get_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, Cell_State* current, Cell_State* next) const
+{
+	for(std::size_t row = 0; row < height; ++row)
+	{
+		std::size_t rank = get_rank(y + row);
+		std::copy_n(get_row(rank, current_system, y + row - first_rows[rank] + 1) + x, width, current + row * width);
+		if(next)
+			std::copy_n(get_row(rank, current_system ^ 0x01, y + row - first_rows[rank] + 1) + x, width, next + row * width);
+	}
+}
+
+void Stripe_System::set_all(Cell_State state)
+{
+	for(std::size_t rank = 0; rank < num_of_ranks; ++rank)
+		std::fill_n(get_row(rank, current_system, 1), (first_rows[rank + 1] - first_rows[rank]) * size_x, state);
+
+	// calc next state for all cells
+	calc_next_generation();
+}
@@ -0,0 +1,98 @@
+// © Copyright (c) 2018 SqYtCO
+
+#ifndef STRIPESYSTEM_H
+#define STRIPESYSTEM_H
+
+#include "basesystem.h"
+#include "configuration.h"
+#include "halotransport.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/* implementation of algorithm using multiple processes
+ * the bounded game board is split into horizontal stripes; each process (rank) owns one stripe and calculates it with the same rules as Cell_System
+ * before each calculation the first and last row of each stripe are exchanged with the neighbor stripes (halo exchange) using a Halo_Transport
+ * the calling process is rank 0 and controls the worker processes; it reads and writes cells directly in the stripe storage provided by the transport */
+class Stripe_System : public Base_System
+{
+	std::unique_ptr<Halo_Transport> transport;		// used transport; currently only Shared_Memory_Transport is available
+	std::size_t num_of_ranks;						// number of stripes/processes
+	std::vector<std::size_t> first_rows;			// first global row of each stripe; first_rows[num_of_ranks] == size_y
+	std::size_t stripe_capacity;					// max. rows of a stripe (without halo rows)
+	bool valid;										// true if all worker processes were started and none of them terminated
+
+	std::size_t current_system;						// index for currently active state of all stripes
+
+	std::size_t survival_rules;						// rules with how many neighbors a cell survives; standard: (1 << 2) | (1 << 3)=0xC
+	std::size_t rebirth_rules;						// rules with how many neighbors a cell is born; standard: (1 << 3)=0x8
+
+	Border_Behavior border_behavior;
+
+	// return pointer to row of given stripe; row 0 is the upper halo, row (rows of stripe + 1) is the lower halo
+	inline Cell_State* get_row(std::size_t rank, std::size_t state, std::size_t row) const
+	{
+		return transport->get_stripe(rank) + (state * (stripe_capacity + 2) + row) * size_x;
+	}
+	// return rank which owns the given global row
+	std::size_t get_rank(std::size_t y) const;
+
+	// exchange halos and calculate next state of all cells of the given stripe; return false if the transport was abandoned
+	bool calc_stripe(std::size_t rank);
+	// advance given stripe by given number of generations and calculate next state afterwards; advanced is set to the num of completed generations
+	// return false if the transport was abandoned; the current state is the last one which was exchanged by all ranks then
+	bool execute_calc(std::size_t rank, std::size_t generations, std::size_t& advanced);
+	// execute received commands until Exit_Stripe is received; only called in worker processes
+	void worker_loop(std::size_t rank);
+
+public:
+	// init instance with given width, height, border behavior, rule sets and number of processes; worker processes are started immediately
+	// Border_Behavior::Borderless is not supported
+	Stripe_System(std::size_t columns, std::size_t rows, const Border_Behavior& border_behavior,
+				std::size_t survival_rules = (1 << 2) | (1 << 3), std::size_t rebirth_rules = (1 << 3), std::size_t processes = 2);
+	// stop worker processes
+	virtual ~Stripe_System() override;
+
+	// return true if the transport was initialized and all worker processes are running; if a worker terminated, the cells can still be read, but not calculated
+	inline bool is_valid() const { return valid; }
+
+	virtual void random_cells(std::size_t alive, std::size_t dead) override;
+
+	// calculate next state of every cell
+	virtual void calc_next_generation() override;
+	virtual void next_generation() override;
+	// update to given generation and calculate next state; rank 0 sends one command for all generations, the halos are exchanged with a barrier in each generation
+	// return num of advanced generations; it is lower than given generations if a worker process terminated
+	std::size_t next_generation(std::size_t generations);
+
+// set functions
+public:
+	// calc_next_generation() must be called to calculate next state correctly
+	virtual void set_cell(std::size_t x, std::size_t y, Cell_State state) override;
+	// calc_next_generation() must not be called, next state is already set
+	virtual void set_all(Cell_State state) override;
+
+// get functions
+public:
+	// return current cell state at given position
+	virtual Cell_State get_cell_state(std::size_t x, std::size_t y) const override
+	{
+		std::size_t rank = get_rank(y);
+		return get_row(rank, current_system, y - first_rows[rank] + 1)[x];
+	}
+
+	// return next cell state at given position
+	virtual Cell_State get_next_cell_state(std::size_t x, std::size_t y) const override
+	{
+		std::size_t rank = get_rank(y);
+		return get_row(rank, current_system ^ 0x01, y - first_rows[rank] + 1)[x];
+	}
+	// copy rows of given rectangle from the stripes
+	virtual void get_cell_states(std::size_t x, std::size_t y, std::size_t width, std::size_t height, Cell_State* current, Cell_State* next = nullptr) const override;
+
+	inline std::size_t get_survival_rules() const { return survival_rules; }
+	inline std::size_t get_rebirth_rules() const { return rebirth_rules; }
+	inline const Border_Behavior& get_border_behavior() const { return border_behavior; }
+};
+
+#endif // STRIPESYSTEM_H
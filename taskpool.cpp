@@ -0,0 +1,123 @@
+// © Copyright (c) 2018 SqYtCO
+
+#include "taskpool.h"
+
+// pool and queue of the current thread; the calling thread of run() is no worker and uses queue 0
+static thread_local const Task_Pool* current_pool = nullptr;
+static thread_local std::size_t current_queue = 0;
+
+Task_Pool::Task_Pool(std::size_t num_of_threads) : num_of_tasks(0), stop(false)
+{
+	if(num_of_threads == 0)
+		num_of_threads = 1;
+
+	for(std::size_t i = 0; i < num_of_threads; ++i)
+		queues.emplace_back(new Task_Queue);
+
+	for(std::size_t i = 1; i < num_of_threads; ++i)
+		workers.emplace_back(&Task_Pool::work, this, i);
+}
+
+Task_Pool::~Task_Pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		stop = true;
+	}
+	wake_up.notify_all();
+
+	for(auto& a : workers)
+		a.join();
+}
+
+std::size_t Task_Pool::get_queue() const
+{
+	return (current_pool == this) ? current_queue : 0;
+}
+
+bool Task_Pool::execute_one(std::size_t queue)
+{
+	Task task;
+	bool found = false;
+
+	// newest task of own queue
+	{
+		std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+		if(!queues[queue]->tasks.empty())
+		{
+			task = queues[queue]->tasks.back();
+			queues[queue]->tasks.pop_back();
+			found = true;
+		}
+	}
+
+	// oldest task of another queue
+	for(std::size_t i = 1; !found && i < queues.size(); ++i)
+	{
+		Task_Queue& other = *queues[(queue + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(other.mutex);
+		if(!other.tasks.empty())
+		{
+			task = other.tasks.front();
+			other.tasks.pop_front();
+			found = true;
+		}
+	}
+
+	if(!found)
+		return false;
+
+	--num_of_tasks;
+	(*task.job)(task.index);
+	task.remaining->fetch_sub(1, std::memory_order_release);
+
+	return true;
+}
+
+void Task_Pool::work(std::size_t queue)
+{
+	current_pool = this;
+	current_queue = queue;
+
+	while(true)
+	{
+		if(execute_one(queue))
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		wake_up.wait(lock, [this] () { return stop || num_of_tasks.load() != 0; });
+		if(stop)
+			return;
+	}
+}
+
+void Task_Pool::run(std::size_t count, const std::function<void(std::size_t)>& job)
+{
+	if(count == 0)
+		return;
+
+	std::size_t queue = get_queue();
+	std::atomic<std::size_t> remaining(count - 1);
+
+	// the first job is executed by the calling thread; the others can be stolen
+	if(count > 1)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+			for(std::size_t i = 1; i < count; ++i)
+				queues[queue]->tasks.push_back(Task{ &job, i, &remaining });
+		}
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			num_of_tasks += count - 1;
+		}
+		wake_up.notify_all();
+	}
+
+	job(0);
+
+	// help executing tasks until all tasks of this call are finished
+	while(remaining.load(std::memory_order_acquire) != 0)
+		if(!execute_one(queue))
+			std::this_thread::yield();
+}
@@ -0,0 +1,68 @@
+// © Copyright (c) 2018 SqYtCO
+
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* fork-join thread pool with work stealing
+ * each thread owns a queue of tasks; it executes the newest task of its own queue and steals the oldest task of another queue if its queue is empty
+ * a thread waiting for its tasks in run() executes other tasks meanwhile, so run() can be called recursively from within a task
+ * the thread which calls run() from outside of the pool uses queue 0; only one such thread is allowed at a time */
+class Task_Pool
+{
+	struct Task
+	{
+		const std::function<void(std::size_t)>* job;
+		std::size_t index;
+		std::atomic<std::size_t>* remaining;		// num of unfinished tasks of the calling run()
+	};
+
+	struct Task_Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Task_Queue>> queues;
+	std::vector<std::thread> workers;
+
+	// num of queued tasks of all queues; idle workers sleep while it is 0
+	std::atomic<std::size_t> num_of_tasks;
+	std::mutex sleep_mutex;
+	std::condition_variable wake_up;
+	bool stop;
+
+	// execute one task of own queue or steal one of another queue; return false if there was no task
+	bool execute_one(std::size_t queue);
+	// loop of worker threads
+	void work(std::size_t queue);
+
+	// return index of queue of calling thread (0 if it is not a worker of this pool)
+	std::size_t get_queue() const;
+
+public:
+	// start num_of_threads - 1 workers; the calling thread of run() is the last one
+	Task_Pool(std::size_t num_of_threads);
+	// stop and join all workers
+	~Task_Pool();
+
+	Task_Pool(const Task_Pool&) = delete;
+	Task_Pool& operator=(const Task_Pool&) = delete;
+
+	// execute job(0) to job(count - 1) in parallel and return after all are finished
+	void run(std::size_t count, const std::function<void(std::size_t)>& job);
+
+	// return num of threads including the calling thread
+	inline std::size_t get_num_of_threads() const { return queues.size(); }
+};
+
+#endif // TASKPOOL_H